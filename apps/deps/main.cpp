@@ -0,0 +1,192 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/batchtokenizer.h"
+#include "cpptok/dependencygraph.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static void print_usage(std::ostream& out)
+{
+  out << "Usage: cpptok-deps [options] paths...\n"
+    << "\n"
+    << "Computes the include dependencies of C/C++ files without running\n"
+    << "the preprocessor. Directories are searched recursively.\n"
+    << "\n"
+    << "Options:\n"
+    << "  -I <dir>          add a directory to the include search paths\n"
+    << "  --format <fmt>    'make' (default) for one rule per translation unit,\n"
+    << "                    'json' for the graph of direct includes\n"
+    << "  -o <file>         write the output to a file instead of stdout\n"
+    << "  -j <n>            number of threads, at most 256 (default: one per core)\n"
+    << "  --quiet           do not print statistics and timings\n"
+    << "  --help            print this message\n";
+}
+
+static void add_roots(cpptok::DependencyGraph& graph, const std::string& path)
+{
+  namespace fs = std::filesystem;
+
+  if (!fs::is_directory(path))
+    return graph.addRoot(path);
+
+  std::vector<std::string> files;
+
+  for (const fs::directory_entry& e : fs::recursive_directory_iterator(path))
+  {
+    if (e.is_regular_file() && cpptok::DependencyGraph::isSourceFile(e.path().string()))
+      files.push_back(e.path().string());
+  }
+
+  std::sort(files.begin(), files.end());
+
+  for (const std::string& f : files)
+    graph.addRoot(f);
+}
+
+static const size_t max_threads = 256;
+
+// parses the value of -j, returns 0 if it is not a number of threads
+static size_t parse_threads(const char* str)
+{
+  if (*str < '0' || *str > '9')
+    return 0;
+
+  char* end = nullptr;
+  errno = 0;
+  const unsigned long n = std::strtoul(str, &end, 10);
+
+  if (errno != 0 || *end != '\0' || n == 0)
+    return 0;
+
+  return static_cast<size_t>(std::min<unsigned long>(n, max_threads));
+}
+
+using Clock = std::chrono::steady_clock;
+
+static double milliseconds(Clock::time_point start, Clock::time_point end)
+{
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+  cpptok::DependencyGraph graph;
+  std::vector<std::string> paths;
+  std::string format = "make";
+  std::string output;
+  size_t threads = 0;
+  bool quiet = false;
+
+  for (int i(1); i < argc; ++i)
+  {
+    const char* arg = argv[i];
+    const bool has_value = i + 1 < argc;
+
+    if (std::strcmp(arg, "-I") == 0 && has_value)
+      graph.addSearchPath(argv[++i]);
+    else if (std::strncmp(arg, "-I", 2) == 0 && arg[2] != '\0')
+      graph.addSearchPath(arg + 2);
+    else if (std::strcmp(arg, "--format") == 0 && has_value)
+      format = argv[++i];
+    else if (std::strcmp(arg, "-o") == 0 && has_value)
+      output = argv[++i];
+    else if (std::strcmp(arg, "-j") == 0 && has_value)
+    {
+      threads = parse_threads(argv[++i]);
+
+      if (threads == 0)
+        return print_usage(std::cerr), 1;
+    }
+    else if (std::strcmp(arg, "--quiet") == 0)
+      quiet = true;
+    else if (std::strcmp(arg, "--help") == 0)
+      return print_usage(std::cout), 0;
+    else if (arg[0] == '-')
+      return print_usage(std::cerr), 1;
+    else
+      paths.push_back(arg);
+  }
+
+  if (paths.empty() || (format != "make" && format != "json"))
+    return print_usage(std::cerr), 1;
+
+  try
+  {
+    const Clock::time_point start = Clock::now();
+
+    for (const std::string& p : paths)
+      add_roots(graph, p);
+
+    const Clock::time_point walked = Clock::now();
+
+    cpptok::BatchTokenizer batch{ threads };
+    graph.scan(batch);
+
+    const Clock::time_point scanned = Clock::now();
+
+    for (const cpptok::DependencyGraph::File& f : graph.files())
+    {
+      if (!f.error.empty())
+        std::cerr << "warning: " << f.error << std::endl;
+    }
+
+    std::ofstream file;
+
+    if (!output.empty())
+    {
+      file.open(output, std::ios::binary);
+
+      if (!file)
+        throw std::runtime_error("could not open " + output);
+    }
+
+    std::ostream& out = output.empty() ? std::cout : file;
+
+    if (format == "json")
+      graph.writeJson(out);
+    else
+      graph.writeMakefile(out);
+
+    out.flush();
+
+    const Clock::time_point written = Clock::now();
+
+    if (!quiet)
+    {
+      const cpptok::DependencyGraph::Statistics& stats = graph.statistics();
+      const double scan_ms = milliseconds(walked, scanned);
+
+      char buffer[512];
+      std::snprintf(buffer, sizeof(buffer),
+        "cpptok-deps: %zu files (%.2f MB, %zu unreadable), %zu includes (%zu unresolved), %zu passes, %zu threads\n"
+        "  walk  %10.2f ms\n"
+        "  scan  %10.2f ms (%.1f MB/s)\n"
+        "  write %10.2f ms\n"
+        "  total %10.2f ms\n",
+        graph.files().size(), stats.bytes / (1024.0 * 1024.0), stats.failed, stats.includes, stats.unresolved,
+        stats.passes, batch.threadCount(),
+        milliseconds(start, walked),
+        scan_ms, scan_ms > 0 ? (stats.bytes / (1024.0 * 1024.0)) / (scan_ms / 1000) : 0,
+        milliseconds(scanned, written),
+        milliseconds(start, written));
+      std::cerr << buffer;
+    }
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "error: " << ex.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
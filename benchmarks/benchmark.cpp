@@ -0,0 +1,135 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "benchmark.h"
+
+#include "cpptok/json.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/*
+ * Global allocation counter.
+ * Replacing the global operator new lets the benchmarks report how many
+ * heap allocations the tokenizer performs per megabyte of input.
+ */
+
+static std::atomic<size_t> g_allocations{ 0 };
+
+void* operator new(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+  if (void* ptr = std::malloc(size ? size : 1))
+    return ptr;
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace bench
+{
+
+size_t allocationCount()
+{
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+static double megabytes(size_t bytes)
+{
+  return bytes / (1024.0 * 1024.0);
+}
+
+double Measurement::megabytesPerSecond() const
+{
+  return best > 0 ? megabytes(bytes) / best : 0;
+}
+
+double Measurement::tokensPerSecond() const
+{
+  return best > 0 ? tokens / best : 0;
+}
+
+double Measurement::nanosecondsPerToken() const
+{
+  return tokens > 0 ? (best * 1e9) / tokens : 0;
+}
+
+double Measurement::allocationsPerMegabyte() const
+{
+  return bytes > 0 ? allocations / megabytes(bytes) : 0;
+}
+
+double Measurement::bytesPerToken() const
+{
+  return tokens > 0 ? double(memory) / tokens : 0;
+}
+
+static void report_json(const std::vector<Measurement>& results, std::ostream& out)
+{
+  out << "{\n  \"benchmarks\": [";
+
+  for (size_t i(0); i < results.size(); ++i)
+  {
+    const Measurement& m = results[i];
+
+    char buffer[512];
+    std::snprintf(buffer, sizeof(buffer),
+      "\"bytes\": %zu, \"tokens\": %zu, \"iterations\": %zu, "
+      "\"best_seconds\": %.9f, \"mean_seconds\": %.9f, "
+      "\"mb_per_second\": %.3f, \"tokens_per_second\": %.1f, "
+      "\"ns_per_token\": %.3f, \"allocations\": %zu, \"allocations_per_mb\": %.3f, "
+      "\"memory_bytes\": %zu, \"bytes_per_token\": %.3f",
+      m.bytes, m.tokens, m.iterations, m.best, m.mean,
+      m.megabytesPerSecond(), m.tokensPerSecond(), m.nanosecondsPerToken(),
+      m.allocations, m.allocationsPerMegabyte(), m.memory, m.bytesPerToken());
+
+    out << (i == 0 ? "\n" : ",\n");
+    out << "    { \"name\": \"" << cpptok::jsonEscape(m.name) << "\", " << buffer << " }";
+  }
+
+  out << "\n  ]\n}\n";
+}
+
+static void report_table(const std::vector<Measurement>& results, std::ostream& out)
+{
+  char buffer[512];
+
+  std::snprintf(buffer, sizeof(buffer), "%-40s %10s %12s %10s %10s %12s %12s\n",
+    "benchmark", "MB/s", "Mtokens/s", "ns/token", "tokens", "allocs/MB", "bytes/token");
+  out << buffer;
+
+  for (const Measurement& m : results)
+  {
+    std::snprintf(buffer, sizeof(buffer), "%-40s %10.2f %12.2f %10.2f %10zu %12.2f %12.2f\n",
+      m.name.c_str(), m.megabytesPerSecond(), m.tokensPerSecond() / 1e6,
+      m.nanosecondsPerToken(), m.tokens, m.allocationsPerMegabyte(), m.bytesPerToken());
+    out << buffer;
+  }
+}
+
+/*!
+ * \fn void report(const std::vector<Measurement>& results, const Options& opts, std::ostream& out)
+ * \brief writes the benchmark results either as a table or as JSON
+ */
+void report(const std::vector<Measurement>& results, const Options& opts, std::ostream& out)
+{
+  if (opts.json)
+    report_json(results, out);
+  else
+    report_table(results, out);
+}
+
+} // namespace bench
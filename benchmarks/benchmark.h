@@ -0,0 +1,110 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_BENCHMARK_H
+#define CPPTOK_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+
+/*!
+ * \class Options
+ * \brief controls how benchmarks are run and reported
+ */
+struct Options
+{
+  double min_time = 0.5; // seconds spent measuring each benchmark
+  size_t min_iterations = 3;
+  size_t synthetic_size = 4 * 1024 * 1024; // bytes per synthetic corpus
+  bool json = false;
+  std::string filter;
+};
+
+/*!
+ * \class Measurement
+ * \brief result of a single benchmark
+ *
+ * Times are per iteration; \c best is the fastest observed iteration
+ * and is the value used to compute throughput.
+ */
+struct Measurement
+{
+  std::string name;
+  size_t bytes = 0;
+  size_t tokens = 0;
+  size_t iterations = 0;
+  double best = 0; // seconds
+  double mean = 0; // seconds
+  size_t allocations = 0;
+  size_t memory = 0; // bytes used to store the tokens, if known
+
+  double megabytesPerSecond() const;
+  double tokensPerSecond() const;
+  double nanosecondsPerToken() const;
+  double allocationsPerMegabyte() const;
+  double bytesPerToken() const;
+};
+
+size_t allocationCount();
+
+inline bool selected(const Options& opts, const std::string& name)
+{
+  return opts.filter.empty() || name.find(opts.filter) != std::string::npos;
+}
+
+/*!
+ * \fn Measurement measure(const std::string& name, size_t bytes, const Options& opts, Fn&& fn)
+ * \brief runs fn repeatedly and collects timing information
+ *
+ * \c fn must process \c bytes bytes of input and return the number of
+ * tokens it produced.
+ */
+template<typename Fn>
+Measurement measure(const std::string& name, size_t bytes, const Options& opts, Fn&& fn)
+{
+  using clock = std::chrono::steady_clock;
+
+  Measurement m;
+  m.name = name;
+  m.bytes = bytes;
+
+  // warm-up run, also used to count allocations
+  size_t allocs = allocationCount();
+  m.tokens = fn();
+  m.allocations = allocationCount() - allocs;
+
+  double total = 0;
+
+  while (m.iterations < opts.min_iterations || total < opts.min_time)
+  {
+    auto start = clock::now();
+    size_t n = fn();
+    auto end = clock::now();
+
+    if (n != m.tokens)
+      throw std::logic_error("benchmark '" + name + "' is not deterministic");
+
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    m.best = m.iterations == 0 ? elapsed : std::min(m.best, elapsed);
+    total += elapsed;
+    ++m.iterations;
+  }
+
+  m.mean = total / m.iterations;
+  return m;
+}
+
+void report(const std::vector<Measurement>& results, const Options& opts, std::ostream& out);
+
+} // namespace bench
+
+#endif // CPPTOK_BENCHMARK_H
@@ -0,0 +1,493 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "corpus.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace bench
+{
+
+/*!
+ * \fn Corpus makeCorpus(std::string name, std::string text)
+ * \brief creates a corpus and splits its text into lines
+ */
+Corpus makeCorpus(std::string name, std::string text)
+{
+  Corpus c;
+  c.name = std::move(name);
+  c.text = std::move(text);
+
+  std::string_view str{ c.text };
+
+  while (!str.empty())
+  {
+    size_t n = str.find('\n');
+
+    if (n == std::string_view::npos)
+    {
+      c.lines.push_back(str);
+      break;
+    }
+
+    c.lines.push_back(str.substr(0, n));
+    str.remove_prefix(n + 1);
+  }
+
+  return c;
+}
+
+/*!
+ * \fn uint64_t next()
+ * \brief returns the next pseudo-random number (splitmix64)
+ */
+uint64_t Random::next()
+{
+  uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static const char* const keywords[] = {
+  "auto", "bool", "break", "case", "catch", "char", "class", "const", "const_cast",
+  "constexpr", "continue", "decltype", "default", "delete", "do", "double",
+  "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "final",
+  "float", "for", "friend", "goto", "if", "import", "inline", "int", "long", "mutable",
+  "namespace", "noexcept", "nullptr", "operator", "override", "private", "protected",
+  "public", "reinterpret_cast", "return", "sizeof", "static", "static_assert",
+  "static_cast", "struct", "switch", "template", "this", "throw", "true", "try",
+  "typedef", "typeid", "typename", "unsigned", "using", "virtual", "void", "while",
+};
+
+static const char* const names[] = {
+  "i", "n", "it", "value", "result", "size", "data", "begin", "end", "count",
+  "index", "node", "parent", "buffer", "offset", "first", "second", "m_value",
+  "std", "vector", "string", "map", "push_back", "emplace", "container", "T",
+};
+
+static const char* const operators[] = {
+  "+", "-", "!", "~", "*", "/", "%", "<", ">", "&", "^", "|", "=",
+  "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+  "*=", "/=", "%=", "+=", "-=", "&=", "|=", "^=", "<<=", ">>=",
+  "::", ",", ".", "?", ":",
+};
+
+template<typename T, size_t N>
+static const T& pick(Random& rng, const T(&array)[N])
+{
+  return array[rng.below(N)];
+}
+
+static void indent(Random& rng, std::string& out)
+{
+  out.append(2 * rng.below(6), ' ');
+}
+
+static void append_identifier(Random& rng, std::string& out, size_t length)
+{
+  static const char first[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+  static const char rest[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+
+  out += first[rng.below(sizeof(first) - 1)];
+
+  for (size_t i(1); i < length; ++i)
+    out += rest[rng.below(sizeof(rest) - 1)];
+}
+
+static void append_number(Random& rng, std::string& out)
+{
+  switch (rng.below(7))
+  {
+  case 0:
+    out += std::to_string(rng.below(1000000));
+    break;
+  case 1:
+    out += "0x" + std::to_string(rng.below(100000)) + "ABCDEF";
+    break;
+  case 2:
+    out += "0b";
+    for (size_t i(0), n(1 + rng.below(32)); i < n; ++i)
+      out += rng.chance(50) ? '1' : '0';
+    break;
+  case 3:
+    out += "0" + std::to_string(rng.below(8 * 8 * 8));
+    break;
+  case 4:
+    out += std::to_string(rng.below(1000)) + "." + std::to_string(rng.below(100000)) + "f";
+    break;
+  case 5:
+    out += std::to_string(rng.below(10)) + "." + std::to_string(rng.below(1000)) + "e-" + std::to_string(rng.below(300));
+    break;
+  default:
+    out += std::to_string(rng.below(100000)) + "_km";
+    break;
+  }
+}
+
+static void append_string(Random& rng, std::string& out)
+{
+  static const char text[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789 ,;:!?";
+
+  out += '"';
+
+  for (size_t i(0), n(rng.below(48)); i < n; ++i)
+  {
+    if (rng.chance(5))
+      out += rng.chance(50) ? "\\n" : "\\\"";
+    else
+      out += text[rng.below(sizeof(text) - 1)];
+  }
+
+  out += '"';
+}
+
+static void append_prose(Random& rng, std::string& out, size_t length)
+{
+  static const char* const words[] = {
+    "the", "tokenizer", "returns", "a", "list", "of", "tokens", "for", "each",
+    "line", "this", "software", "is", "provided", "as", "without", "warranty",
+    "\\brief", "\\param", "@return", "see", "copyright", "notice", "in", "LICENSE",
+  };
+
+  while (length > 0)
+  {
+    std::string_view w = pick(rng, words);
+    out += w;
+    out += ' ';
+    length = length > w.size() + 1 ? length - w.size() - 1 : 0;
+  }
+}
+
+/*!
+ * \fn std::string generateKeywordHeavy(size_t size)
+ * \brief generates code made almost exclusively of keywords
+ */
+std::string generateKeywordHeavy(size_t size)
+{
+  Random rng{ 1 };
+  std::string out;
+  out.reserve(size + 128);
+
+  while (out.size() < size)
+  {
+    indent(rng, out);
+
+    for (size_t i(0), n(4 + rng.below(8)); i < n; ++i)
+    {
+      out += rng.chance(85) ? pick(rng, keywords) : pick(rng, names);
+      out += ' ';
+    }
+
+    out += rng.chance(70) ? ";\n" : "{\n";
+  }
+
+  return out;
+}
+
+/*!
+ * \fn std::string generateCommentHeavy(size_t size)
+ * \brief generates license headers, doxygen blocks and line comments
+ */
+std::string generateCommentHeavy(size_t size)
+{
+  Random rng{ 2 };
+  std::string out;
+  out.reserve(size + 256);
+
+  while (out.size() < size)
+  {
+    switch (rng.below(3))
+    {
+    case 0:
+    {
+      out += "/*\n";
+      for (size_t i(0), n(5 + rng.below(20)); i < n; ++i)
+      {
+        out += " * ";
+        append_prose(rng, out, 40 + rng.below(40));
+        out += '\n';
+      }
+      out += " */\n";
+      break;
+    }
+    case 1:
+    {
+      for (size_t i(0), n(1 + rng.below(6)); i < n; ++i)
+      {
+        indent(rng, out);
+        out += "// ";
+        append_prose(rng, out, 20 + rng.below(60));
+        out += '\n';
+      }
+      break;
+    }
+    default:
+    {
+      indent(rng, out);
+      out += "int ";
+      out += pick(rng, names);
+      out += " = 0; /* ";
+      append_prose(rng, out, 10 + rng.below(20));
+      out += "*/\n";
+      break;
+    }
+    }
+  }
+
+  return out;
+}
+
+/*!
+ * \fn std::string generateLiteralHeavy(size_t size)
+ * \brief generates numeric, string and character literals
+ */
+std::string generateLiteralHeavy(size_t size)
+{
+  Random rng{ 3 };
+  std::string out;
+  out.reserve(size + 256);
+
+  while (out.size() < size)
+  {
+    indent(rng, out);
+    out += "{ ";
+
+    for (size_t i(0), n(2 + rng.below(8)); i < n; ++i)
+    {
+      switch (rng.below(3))
+      {
+      case 0:
+        append_string(rng, out);
+        break;
+      case 1:
+        out += '\'';
+        out += static_cast<char>('a' + rng.below(26));
+        out += '\'';
+        break;
+      default:
+        append_number(rng, out);
+        break;
+      }
+
+      out += ", ";
+    }
+
+    out += "},\n";
+  }
+
+  return out;
+}
+
+/*!
+ * \fn std::string generateLongIdentifiers(size_t size)
+ * \brief generates declarations using very long, mangled-looking names
+ */
+std::string generateLongIdentifiers(size_t size)
+{
+  Random rng{ 4 };
+  std::string out;
+  out.reserve(size + 512);
+
+  while (out.size() < size)
+  {
+    indent(rng, out);
+    append_identifier(rng, out, 30 + rng.below(90));
+    out += ' ';
+    append_identifier(rng, out, 30 + rng.below(90));
+    out += " = ";
+    append_identifier(rng, out, 30 + rng.below(90));
+    out += "(";
+    append_identifier(rng, out, 30 + rng.below(90));
+    out += ");\n";
+  }
+
+  return out;
+}
+
+/*!
+ * \fn std::string generateOperatorSoup(size_t size)
+ * \brief generates expressions made mostly of operators
+ */
+std::string generateOperatorSoup(size_t size)
+{
+  Random rng{ 5 };
+  std::string out;
+  out.reserve(size + 128);
+
+  while (out.size() < size)
+  {
+    indent(rng, out);
+
+    for (size_t i(0), n(8 + rng.below(24)); i < n; ++i)
+    {
+      if (rng.chance(30))
+        out += pick(rng, names);
+      else if (rng.chance(10))
+        out += rng.chance(50) ? "(" : ")";
+      else
+        out += pick(rng, operators);
+
+      if (rng.chance(20))
+        out += ' ';
+    }
+
+    out += ";\n";
+  }
+
+  return out;
+}
+
+/*!
+ * \fn std::string generateMixed(size_t size)
+ * \brief generates code resembling a typical C++ source file
+ */
+std::string generateMixed(size_t size)
+{
+  Random rng{ 6 };
+  std::string out;
+  out.reserve(size + 512);
+
+  out += "// Copyright (C) 2022 Someone\n";
+  out += "#include <vector>\n#include \"foo/bar.h\"\n\n";
+
+  while (out.size() < size)
+  {
+    switch (rng.below(6))
+    {
+    case 0:
+      out += "/*!\n * \\fn ";
+      append_prose(rng, out, 30);
+      out += "\n */\n";
+      break;
+    case 1:
+      indent(rng, out);
+      out += "for (size_t i(0); i < ";
+      out += pick(rng, names);
+      out += ".size(); ++i)\n";
+      break;
+    case 2:
+      indent(rng, out);
+      out += "if (";
+      out += pick(rng, names);
+      out += " == ";
+      append_number(rng, out);
+      out += " && !";
+      out += pick(rng, names);
+      out += ")\n";
+      break;
+    case 3:
+      indent(rng, out);
+      out += "std::string ";
+      out += pick(rng, names);
+      out += " = ";
+      append_string(rng, out);
+      out += "; // ";
+      append_prose(rng, out, 20);
+      out += '\n';
+      break;
+    case 4:
+      indent(rng, out);
+      out += rng.chance(50) ? "{\n" : "}\n";
+      break;
+    default:
+      indent(rng, out);
+      out += "return ";
+      out += pick(rng, names);
+      out += "->";
+      out += pick(rng, names);
+      out += "(";
+      out += pick(rng, names);
+      out += ", ";
+      append_number(rng, out);
+      out += ");\n";
+      break;
+    }
+  }
+
+  return out;
+}
+
+/*!
+ * \fn std::vector<Corpus> syntheticCorpora(size_t size)
+ * \brief returns all the synthetic corpora, each of roughly the given size
+ */
+std::vector<Corpus> syntheticCorpora(size_t size)
+{
+  std::vector<Corpus> result;
+  result.push_back(makeCorpus("keywords", generateKeywordHeavy(size)));
+  result.push_back(makeCorpus("comments", generateCommentHeavy(size)));
+  result.push_back(makeCorpus("literals", generateLiteralHeavy(size)));
+  result.push_back(makeCorpus("long-identifiers", generateLongIdentifiers(size)));
+  result.push_back(makeCorpus("operators", generateOperatorSoup(size)));
+  result.push_back(makeCorpus("mixed", generateMixed(size)));
+  return result;
+}
+
+static bool is_source_file(const std::filesystem::path& p)
+{
+  static const char* const extensions[] = {
+    ".h", ".hh", ".hpp", ".hxx", ".c", ".cc", ".cpp", ".cxx", ".inl", ".ipp",
+  };
+
+  const std::string ext = p.extension().string();
+  return std::find(std::begin(extensions), std::end(extensions), ext) != std::end(extensions);
+}
+
+static void read_file(const std::filesystem::path& p, std::string& out)
+{
+  std::ifstream file{ p, std::ios::binary };
+
+  if (!file)
+    throw std::runtime_error("could not open " + p.string());
+
+  std::ostringstream ss;
+  ss << file.rdbuf();
+  out += ss.str();
+
+  if (!out.empty() && out.back() != '\n')
+    out += '\n';
+}
+
+/*!
+ * \fn Corpus loadCorpus(const std::string& path)
+ * \brief loads a corpus from disk
+ *
+ * If \c path is a directory, all the C/C++ source files it contains
+ * (recursively) are concatenated, in a deterministic order.
+ */
+Corpus loadCorpus(const std::string& path)
+{
+  namespace fs = std::filesystem;
+
+  std::string text;
+
+  if (fs::is_directory(path))
+  {
+    std::vector<fs::path> files;
+
+    for (const fs::directory_entry& e : fs::recursive_directory_iterator(path))
+    {
+      if (e.is_regular_file() && is_source_file(e.path()))
+        files.push_back(e.path());
+    }
+
+    std::sort(files.begin(), files.end());
+
+    for (const fs::path& p : files)
+      read_file(p, text);
+  }
+  else
+  {
+    read_file(path, text);
+  }
+
+  return makeCorpus("disk:" + path, std::move(text));
+}
+
+} // namespace bench
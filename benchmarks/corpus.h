@@ -0,0 +1,65 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_BENCHMARK_CORPUS_H
+#define CPPTOK_BENCHMARK_CORPUS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bench
+{
+
+/*!
+ * \class Corpus
+ * \brief a named input for the benchmarks
+ *
+ * The text is split into lines once so that the benchmarks only measure
+ * the tokenizer.
+ */
+struct Corpus
+{
+  std::string name;
+  std::string text;
+  std::vector<std::string_view> lines;
+};
+
+Corpus makeCorpus(std::string name, std::string text);
+
+/*!
+ * \class Random
+ * \brief a small deterministic pseudo-random generator
+ *
+ * The standard distributions are implementation-defined, so we use our
+ * own generator to produce the same corpora on every platform.
+ */
+class Random
+{
+public:
+  explicit Random(uint64_t seed) : m_state(seed) { }
+
+  uint64_t next();
+  size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+  bool chance(int percent) { return below(100) < static_cast<size_t>(percent); }
+
+private:
+  uint64_t m_state;
+};
+
+std::string generateKeywordHeavy(size_t size);
+std::string generateCommentHeavy(size_t size);
+std::string generateLiteralHeavy(size_t size);
+std::string generateLongIdentifiers(size_t size);
+std::string generateOperatorSoup(size_t size);
+std::string generateMixed(size_t size);
+
+std::vector<Corpus> syntheticCorpora(size_t size);
+
+Corpus loadCorpus(const std::string& path);
+
+} // namespace bench
+
+#endif // CPPTOK_BENCHMARK_CORPUS_H
@@ -0,0 +1,85 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "suites.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void print_usage(std::ostream& out)
+{
+  out << "Usage: cpptok_bench [options] [paths...]\n"
+    << "\n"
+    << "Runs the cpptok benchmarks on synthetic corpora and, optionally, on\n"
+    << "the given files or directories.\n"
+    << "\n"
+    << "Options:\n"
+    << "  --json            output the results as JSON\n"
+    << "  --filter <str>    only run benchmarks whose name contains <str>\n"
+    << "  --size <MB>       size of each synthetic corpus (default: 4)\n"
+    << "  --min-time <s>    minimum time spent in each benchmark (default: 0.5)\n"
+    << "  --no-synthetic    do not generate the synthetic corpora\n"
+    << "  --no-micro        do not run the microbenchmarks\n"
+    << "  --help            print this message\n";
+}
+
+int main(int argc, char* argv[])
+{
+  bench::Options opts;
+  bool synthetic = true;
+  bool micro = true;
+  std::vector<std::string> paths;
+
+  for (int i(1); i < argc; ++i)
+  {
+    const char* arg = argv[i];
+    const bool has_value = i + 1 < argc;
+
+    if (std::strcmp(arg, "--json") == 0)
+      opts.json = true;
+    else if (std::strcmp(arg, "--filter") == 0 && has_value)
+      opts.filter = argv[++i];
+    else if (std::strcmp(arg, "--size") == 0 && has_value)
+      opts.synthetic_size = static_cast<size_t>(std::atof(argv[++i]) * 1024 * 1024);
+    else if (std::strcmp(arg, "--min-time") == 0 && has_value)
+      opts.min_time = std::atof(argv[++i]);
+    else if (std::strcmp(arg, "--no-synthetic") == 0)
+      synthetic = false;
+    else if (std::strcmp(arg, "--no-micro") == 0)
+      micro = false;
+    else if (std::strcmp(arg, "--help") == 0)
+      return print_usage(std::cout), 0;
+    else if (arg[0] == '-')
+      return print_usage(std::cerr), 1;
+    else
+      paths.push_back(arg);
+  }
+
+  try
+  {
+    std::vector<bench::Corpus> corpora;
+
+    if (synthetic)
+      corpora = bench::syntheticCorpora(opts.synthetic_size);
+
+    for (const std::string& p : paths)
+      corpora.push_back(bench::loadCorpus(p));
+
+    std::vector<bench::Measurement> results;
+    bench::runThroughputBenchmarks(corpora, opts, results);
+
+    if (micro)
+      bench::runMicroBenchmarks(opts, results);
+
+    bench::report(results, opts, std::cout);
+  }
+  catch (const std::exception& ex)
+  {
+    std::cerr << "error: " << ex.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
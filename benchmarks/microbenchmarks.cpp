@@ -0,0 +1,334 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "suites.h"
+
+#include "cpptok/identifiertable.h"
+#include "cpptok/tokenizer.h"
+
+#include <cstdio>
+
+namespace bench
+{
+
+/*
+ * Microbenchmarks: each routine of the Tokenizer is run in isolation on
+ * a list of inputs that all start with the construct it handles.
+ */
+
+class TokenizerProbe : public cpptok::Tokenizer
+{
+public:
+  using Tokenizer::setInput;
+  using Tokenizer::readChar;
+  using Tokenizer::consumeDiscardable;
+  using Tokenizer::readNumericLiteral;
+  using Tokenizer::readHexa;
+  using Tokenizer::readDecimal;
+  using Tokenizer::readIdentifier;
+  using Tokenizer::identifierType;
+  using Tokenizer::readStringLiteral;
+  using Tokenizer::getOperator;
+  using Tokenizer::readOperator;
+  using Tokenizer::readMultiLineComment;
+
+  void setInput(std::string_view str) { setInput(str.data(), str.size()); }
+};
+
+/*!
+ * \class Inputs
+ * \brief a list of inputs stored in a single buffer
+ */
+struct Inputs
+{
+  std::string buffer;
+  std::vector<std::pair<size_t, size_t>> ranges;
+
+  void add(const std::string& str)
+  {
+    ranges.emplace_back(buffer.size(), str.size());
+    buffer += str;
+  }
+
+  std::string_view operator[](size_t i) const
+  {
+    return std::string_view(buffer).substr(ranges[i].first, ranges[i].second);
+  }
+
+  size_t size() const { return ranges.size(); }
+  size_t bytes() const { return buffer.size(); }
+};
+
+static const size_t nb_inputs = 100000;
+
+static std::string random_identifier(Random& rng)
+{
+  static const char* const keywords[] = {
+    "int", "auto", "const", "return", "virtual", "template", "namespace", "static_cast",
+  };
+
+  static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+
+  if (rng.chance(30))
+    return keywords[rng.below(sizeof(keywords) / sizeof(keywords[0]))];
+
+  std::string result{ chars[rng.below(53)] };
+
+  for (size_t i(0), n(rng.below(rng.chance(90) ? 12 : 60)); i < n; ++i)
+    result += chars[rng.below(sizeof(chars) - 1)];
+
+  return result;
+}
+
+static std::string random_decimal(Random& rng)
+{
+  std::string result = std::to_string(1 + rng.below(100000));
+
+  if (rng.chance(50))
+    result += "." + std::to_string(rng.below(1000));
+
+  if (rng.chance(20))
+    result += "e-" + std::to_string(rng.below(100));
+
+  return result;
+}
+
+static std::string random_hexa(Random& rng)
+{
+  static const char digits[] = "0123456789abcdefABCDEF";
+
+  std::string result = "0x";
+
+  for (size_t i(0), n(1 + rng.below(16)); i < n; ++i)
+    result += digits[rng.below(sizeof(digits) - 1)];
+
+  return result;
+}
+
+static std::string random_operator(Random& rng)
+{
+  static const char* const operators[] = {
+    "+", "-", "!", "~", "*", "%", "<", ">", "&", "^", "|", "=",
+    "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+    "*=", "%=", "+=", "-=", "&=", "|=", "^=", "<<=", ">>=",
+  };
+
+  return operators[rng.below(sizeof(operators) / sizeof(operators[0]))];
+}
+
+static std::string operator_run(size_t size)
+{
+  Random rng{ 18 };
+  std::string result;
+
+  while (result.size() < size)
+    result += random_operator(rng);
+
+  return result;
+}
+
+static std::string random_string_literal(Random& rng)
+{
+  std::string result = "\"";
+
+  for (size_t i(0), n(rng.below(64)); i < n; ++i)
+    result += rng.chance(5) ? "\\\"" : std::string(1, static_cast<char>('a' + rng.below(26)));
+
+  return result + "\"";
+}
+
+static std::string random_comment(Random& rng)
+{
+  std::string result = "/*";
+
+  for (size_t i(0), n(rng.below(200)); i < n; ++i)
+    result += rng.chance(3) ? '*' : static_cast<char>('a' + rng.below(26));
+
+  return result + "*/";
+}
+
+static std::string random_whitespace(Random& rng)
+{
+  static const char spaces[] = " \t\r\n";
+
+  std::string result;
+
+  for (size_t i(0), n(rng.below(32)); i < n; ++i)
+    result += rng.chance(80) ? ' ' : spaces[rng.below(4)];
+
+  return result + "x";
+}
+
+template<typename Gen>
+static Inputs generate(uint64_t seed, Gen&& gen)
+{
+  Random rng{ seed };
+  Inputs inputs;
+
+  for (size_t i(0); i < nb_inputs; ++i)
+    inputs.add(gen(rng));
+
+  return inputs;
+}
+
+// user-supplied names that only differ in a few characters
+static Inputs same_shape_names()
+{
+  Inputs inputs;
+
+  for (size_t i(0); i < 20000; ++i)
+  {
+    char name[32];
+    std::snprintf(name, sizeof(name), "PROJ_%05d_MACRO", static_cast<int>(i));
+    inputs.add(name);
+  }
+
+  return inputs;
+}
+
+static Inputs single(std::string str)
+{
+  Inputs inputs;
+  inputs.add(str);
+  return inputs;
+}
+
+/*!
+ * \fn void run(const std::string& name, const Inputs& inputs, const Options& opts, std::vector<Measurement>& results, Fn&& fn)
+ * \brief measures fn on every input
+ *
+ * \c fn receives the input and a probe whose input is already set.
+ *
+ * The reported number of "tokens" is the number of inputs processed.
+ */
+template<typename Fn>
+static void run(const std::string& name, const Inputs& inputs, const Options& opts, std::vector<Measurement>& results, Fn&& fn)
+{
+  if (!selected(opts, name))
+    return;
+
+  TokenizerProbe probe;
+
+  results.push_back(measure(name, inputs.bytes(), opts, [&]() -> size_t {
+    probe.output.clear();
+
+    for (size_t i(0); i < inputs.size(); ++i)
+    {
+      probe.setInput(inputs[i]);
+      fn(probe, inputs[i]);
+    }
+
+    return inputs.size();
+    }));
+}
+
+/*!
+ * \fn void runTokenize(const std::string& name, const Inputs& inputs, const Options& opts, std::vector<Measurement>& results)
+ * \brief measures tokenize() on every input, reporting the number of tokens produced
+ */
+static void runTokenize(const std::string& name, const Inputs& inputs, const Options& opts, std::vector<Measurement>& results)
+{
+  if (!selected(opts, name))
+    return;
+
+  cpptok::Tokenizer lexer;
+
+  results.push_back(measure(name, inputs.bytes(), opts, [&]() -> size_t {
+    lexer.reset();
+
+    for (size_t i(0); i < inputs.size(); ++i)
+    {
+      std::string_view str = inputs[i];
+      lexer.tokenize(str.data(), str.size());
+    }
+
+    return lexer.output.size();
+    }));
+}
+
+/*!
+ * \fn void runMicroBenchmarks(const Options& opts, std::vector<Measurement>& results)
+ * \brief measures the individual routines of the tokenizer
+ */
+void runMicroBenchmarks(const Options& opts, std::vector<Measurement>& results)
+{
+  const Inputs identifiers = generate(11, random_identifier);
+  const Inputs decimals = generate(12, random_decimal);
+  const Inputs hexas = generate(13, random_hexa);
+  const Inputs operators = generate(14, random_operator);
+  const Inputs strings = generate(15, random_string_literal);
+  const Inputs comments = generate(16, random_comment);
+  const Inputs whitespaces = generate(17, random_whitespace);
+
+  run("micro/readIdentifier", identifiers, opts, results, [](TokenizerProbe& p, std::string_view) {
+    p.readChar();
+    p.readIdentifier();
+    });
+
+  run("micro/identifierType", identifiers, opts, results, [](TokenizerProbe& p, std::string_view str) {
+    p.output.emplace_back(p.identifierType(0, str.size()), str);
+    });
+
+  if (selected(opts, "micro/IdentifierTable::lookup"))
+  {
+    const Inputs names = same_shape_names();
+    cpptok::IdentifierTable table;
+
+    for (size_t i(0); i < names.size(); ++i)
+      table.add(names[i], cpptok::TokenType::UserKind0);
+
+    run("micro/IdentifierTable::lookup", names, opts, results, [&table](TokenizerProbe& p, std::string_view str) {
+      p.output.emplace_back(table.lookup(str), str);
+      });
+  }
+
+  run("micro/readNumericLiteral", decimals, opts, results, [](TokenizerProbe& p, std::string_view) {
+    p.readChar();
+    p.readNumericLiteral();
+    });
+
+  run("micro/readDecimal", decimals, opts, results, [](TokenizerProbe& p, std::string_view) {
+    p.readDecimal();
+    });
+
+  run("micro/readHexa", hexas, opts, results, [](TokenizerProbe& p, std::string_view) {
+    p.readChar();
+    p.readHexa();
+    });
+
+  run("micro/readOperator", operators, opts, results, [](TokenizerProbe& p, std::string_view) {
+    p.readChar();
+    p.readOperator();
+    });
+
+  run("micro/getOperator", operators, opts, results, [](TokenizerProbe& p, std::string_view str) {
+    p.output.emplace_back(p.getOperator(0, str.size()), str);
+    });
+
+  run("micro/readStringLiteral", strings, opts, results, [](TokenizerProbe& p, std::string_view) {
+    p.readChar();
+    p.readStringLiteral();
+    });
+
+  run("micro/readMultiLineComment", comments, opts, results, [](TokenizerProbe& p, std::string_view) {
+    p.readChar();
+    p.readMultiLineComment();
+    });
+
+  run("micro/consumeDiscardable", whitespaces, opts, results, [](TokenizerProbe& p, std::string_view) {
+    p.consumeDiscardable();
+    });
+
+  // pathological inputs
+
+  runTokenize("pathological/operator-run-10k", single(std::string(10000, '<')), opts, results);
+  runTokenize("pathological/mixed-operator-run-10k", single(operator_run(10000)), opts, results);
+  runTokenize("pathological/comment-1MB", single("/*" + std::string(1024 * 1024, 'x') + "*/"), opts, results);
+  runTokenize("pathological/stars-comment-1MB", single("/*" + std::string(1024 * 1024, '*') + "/"), opts, results);
+  runTokenize("pathological/whitespace-1MB", single(std::string(1024 * 1024, ' ') + "x"), opts, results);
+  runTokenize("pathological/identifier-64KB", single(std::string(64 * 1024, 'a')), opts, results);
+  runTokenize("pathological/string-1MB", single("\"" + std::string(1024 * 1024, 's') + "\""), opts, results);
+}
+
+} // namespace bench
@@ -0,0 +1,19 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_BENCHMARK_SUITES_H
+#define CPPTOK_BENCHMARK_SUITES_H
+
+#include "benchmark.h"
+#include "corpus.h"
+
+namespace bench
+{
+
+void runThroughputBenchmarks(const std::vector<Corpus>& corpora, const Options& opts, std::vector<Measurement>& results);
+void runMicroBenchmarks(const Options& opts, std::vector<Measurement>& results);
+
+} // namespace bench
+
+#endif // CPPTOK_BENCHMARK_SUITES_H
@@ -0,0 +1,375 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "suites.h"
+
+#include "cpptok/batchtokenizer.h"
+#include "cpptok/compressedtokenbuffer.h"
+#include "cpptok/identifiertable.h"
+#include "cpptok/includescanner.h"
+#include "cpptok/symboltable.h"
+#include "cpptok/tokenizer.h"
+#include "cpptok/tokenbuffer.h"
+#include "cpptok/tokencache.h"
+#include "cpptok/tokensinks.h"
+#include "cpptok/tokenstream.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+#include <iterator>
+
+namespace bench
+{
+
+/*
+ * End-to-end benchmarks: each corpus is fed line by line to a fresh
+ * Tokenizer, the way an indexer would process a file.
+ */
+
+static size_t tokenize_lines(const Corpus& corpus, size_t& memory)
+{
+  cpptok::Tokenizer lexer;
+
+  for (std::string_view line : corpus.lines)
+    lexer.tokenize(line.data(), line.size());
+
+  memory = lexer.output.capacity() * sizeof(cpptok::Token);
+  return lexer.output.size();
+}
+
+static size_t tokenize_lines_batch(const Corpus& corpus, size_t& memory)
+{
+  cpptok::Tokenizer lexer;
+  std::vector<size_t> offsets;
+  lexer.tokenizeLines(corpus.lines.data(), corpus.lines.size(), offsets);
+
+  memory = lexer.output.capacity() * sizeof(cpptok::Token) + offsets.capacity() * sizeof(size_t);
+  return lexer.output.size();
+}
+
+static size_t tokenize_lines_classifying(const Corpus& corpus, size_t& memory)
+{
+  static const cpptok::IdentifierTable table = []() {
+    cpptok::IdentifierTable t;
+    t.add("concept", cpptok::TokenType::UserKind0);
+    t.add("requires", cpptok::TokenType::UserKind0);
+    t.add("co_await", cpptok::TokenType::UserKind0);
+    t.add("Q_OBJECT", cpptok::TokenType::UserKind1);
+    t.add("signals", cpptok::TokenType::UserKind2);
+    t.add("slots", cpptok::TokenType::UserKind2);
+    return t;
+  }();
+
+  cpptok::Tokenizer lexer;
+  lexer.identifiers = &table;
+
+  for (std::string_view line : corpus.lines)
+    lexer.tokenize(line.data(), line.size());
+
+  memory = lexer.output.capacity() * sizeof(cpptok::Token);
+  return lexer.output.size();
+}
+
+static size_t tokenize_lines_interning(const Corpus& corpus, size_t& memory)
+{
+  cpptok::Tokenizer lexer;
+  cpptok::SymbolTable table;
+  cpptok::SymbolIndex index{ table };
+  lexer.symbols = &index;
+
+  for (std::string_view line : corpus.lines)
+    lexer.tokenize(line.data(), line.size());
+
+  memory = lexer.output.capacity() * sizeof(cpptok::Token) + index.ids().capacity() * sizeof(uint32_t);
+  return lexer.output.size();
+}
+
+static size_t tokenize_lines_counting(const Corpus& corpus, size_t& memory)
+{
+  cpptok::BasicTokenizer<cpptok::CountingSink> lexer;
+
+  for (std::string_view line : corpus.lines)
+    lexer.tokenize(line.data(), line.size());
+
+  memory = 0;
+  return lexer.sink().count();
+}
+
+static size_t tokenize_lines_span(const Corpus& corpus, size_t& memory)
+{
+  cpptok::Tokenizer lexer;
+  cpptok::Token span[256];
+  size_t count = 0;
+
+  for (std::string_view line : corpus.lines)
+  {
+    lexer.setInput(line.data(), line.size());
+
+    size_t n;
+
+    do
+    {
+      n = lexer.fill(span, std::size(span));
+      count += n;
+    } while (n == std::size(span));
+  }
+
+  memory = sizeof(span);
+  return count;
+}
+
+static size_t tokenize_lines_compact(const Corpus& corpus, size_t& memory)
+{
+  cpptok::Tokenizer lexer;
+  cpptok::TokenBuffer buffer{ corpus.text };
+
+  for (std::string_view line : corpus.lines)
+  {
+    lexer.tokenize(line.data(), line.size());
+    buffer.append(lexer.output);
+    lexer.output.clear();
+  }
+
+  memory = buffer.memoryUsage();
+  return buffer.size();
+}
+
+// same as tokenize-compact, with a CompressedTokenBuffer whose tokens
+// are then read back sequentially
+static size_t tokenize_lines_compressed(const Corpus& corpus, size_t& memory)
+{
+  cpptok::Tokenizer lexer;
+  cpptok::CompressedTokenBuffer buffer{ corpus.text };
+
+  for (std::string_view line : corpus.lines)
+  {
+    lexer.tokenize(line.data(), line.size());
+    buffer.append(lexer.output);
+    lexer.output.clear();
+  }
+
+  size_t count = 0;
+
+  for (auto it = buffer.begin(); it != buffer.end(); ++it)
+    count += (*it).isValid();
+
+  memory = buffer.memoryUsage();
+  return count;
+}
+
+static size_t tokenize_buffer(const Corpus& corpus, size_t& memory)
+{
+  cpptok::Tokenizer lexer;
+  cpptok::LineIndex lines;
+  lexer.tokenizeBuffer(corpus.text, &lines);
+
+  memory = lexer.output.capacity() * sizeof(cpptok::Token) + lines.lineStarts().capacity() * sizeof(size_t);
+  return lexer.output.size();
+}
+
+// reports the number of include directives as the token count
+static size_t scan_includes(const Corpus& corpus, size_t& memory)
+{
+  std::vector<cpptok::IncludeDirective> includes;
+  cpptok::scanIncludes(corpus.text, includes);
+
+  memory = includes.capacity() * sizeof(cpptok::IncludeDirective);
+  return includes.size();
+}
+
+/*
+ * A directory created for a single benchmark, removed with its content
+ * when it goes out of scope. The name is random so that concurrent runs
+ * do not use (and remove) the files of each other.
+ */
+class TemporaryDirectory
+{
+public:
+  TemporaryDirectory()
+  {
+    std::random_device rng;
+
+    for (;;)
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "cpptok_bench_%08x%08x", rng(), rng());
+      m_path = std::filesystem::temp_directory_path() / name;
+
+      // fails if the directory already exists
+      if (std::filesystem::create_directory(m_path))
+        break;
+    }
+  }
+
+  TemporaryDirectory(const TemporaryDirectory&) = delete;
+
+  ~TemporaryDirectory()
+  {
+    std::error_code ec;
+    std::filesystem::remove_all(m_path, ec);
+  }
+
+  std::string path(const std::string& name) const { return (m_path / name).string(); }
+
+private:
+  std::filesystem::path m_path;
+};
+
+// writes the tokens of a corpus in a token stream file
+static std::string write_stream(const Corpus& corpus, const TemporaryDirectory& dir)
+{
+  cpptok::Tokenizer lexer;
+  lexer.tokenizeBuffer(corpus.text);
+
+  cpptok::TokenBuffer tokens{ corpus.text };
+  tokens.append(lexer.output);
+
+  const std::string path = dir.path(corpus.name + ".tokens");
+  cpptok::TokenStream::write(path, corpus.text, tokens);
+  return path;
+}
+
+// a warm restart: the stream is mapped, checked against the source,
+// and its tokens are read
+static size_t load_stream(const std::string& path, const Corpus& corpus, size_t& memory)
+{
+  cpptok::TokenStream stream{ path };
+
+  if (!stream.matches(corpus.text))
+    return 0;
+
+  size_t count = 0;
+
+  for (size_t i(0); i < stream.size(); ++i)
+    count += stream.token(i, corpus.text).isValid();
+
+  memory = stream.file().size();
+  return count;
+}
+
+// a warm cache: the corpus is hashed, found in the cache and its tokens are read
+static size_t tokenize_cached(cpptok::TokenCache& cache, const Corpus& corpus, size_t& memory)
+{
+  cpptok::TokenStream stream = cache.tokenize(corpus.text);
+  size_t count = 0;
+
+  for (size_t i(0); i < stream.size(); ++i)
+    count += stream.token(i, corpus.text).isValid();
+
+  memory = stream.file().size();
+  return count;
+}
+
+// splits a corpus into "files" of about 64KB, at line boundaries
+static std::vector<std::string_view> split_corpus(const Corpus& corpus)
+{
+  std::vector<std::string_view> files;
+  const char* begin = corpus.text.data();
+
+  for (std::string_view line : corpus.lines)
+  {
+    const char* end = line.data() + line.size();
+
+    if (size_t(end - begin) >= 64 * 1024)
+    {
+      files.emplace_back(begin, end - begin);
+      begin = end;
+    }
+  }
+
+  files.emplace_back(begin, corpus.text.data() + corpus.text.size() - begin);
+  return files;
+}
+
+static size_t tokenize_batch(cpptok::BatchTokenizer& batch, const std::vector<std::string_view>& files, size_t& memory)
+{
+  std::vector<cpptok::TokenBuffer> buffers = batch.tokenizeBuffers(files);
+
+  size_t count = 0;
+  memory = 0;
+
+  for (const cpptok::TokenBuffer& buffer : buffers)
+  {
+    count += buffer.size();
+    memory += buffer.memoryUsage();
+  }
+
+  return count;
+}
+
+static size_t tokenize_chunked(cpptok::BatchTokenizer& batch, const Corpus& corpus, size_t& memory)
+{
+  cpptok::TokenBuffer buffer = batch.tokenizeChunked(corpus.text, 256 * 1024);
+  memory = buffer.memoryUsage();
+  return buffer.size();
+}
+
+template<typename Fn>
+static void run(const std::string& name, const Corpus& corpus, const Options& opts, std::vector<Measurement>& results, Fn&& fn)
+{
+  if (!selected(opts, name))
+    return;
+
+  size_t memory = 0;
+
+  results.push_back(measure(name, corpus.text.size(), opts, [&]() {
+    return fn(corpus, memory);
+    }));
+
+  results.back().memory = memory;
+}
+
+/*!
+ * \fn void runThroughputBenchmarks(const std::vector<Corpus>& corpora, const Options& opts, std::vector<Measurement>& results)
+ * \brief measures the throughput of Tokenizer::tokenize() on each corpus
+ */
+void runThroughputBenchmarks(const std::vector<Corpus>& corpora, const Options& opts, std::vector<Measurement>& results)
+{
+  cpptok::BatchTokenizer batch;
+
+  for (const Corpus& corpus : corpora)
+  {
+    run("tokenize/" + corpus.name, corpus, opts, results, tokenize_lines);
+    run("tokenize-lines/" + corpus.name, corpus, opts, results, tokenize_lines_batch);
+    run("tokenize-classify/" + corpus.name, corpus, opts, results, tokenize_lines_classifying);
+    run("tokenize-intern/" + corpus.name, corpus, opts, results, tokenize_lines_interning);
+    run("tokenize-count/" + corpus.name, corpus, opts, results, tokenize_lines_counting);
+    run("tokenize-span/" + corpus.name, corpus, opts, results, tokenize_lines_span);
+    run("tokenize-compact/" + corpus.name, corpus, opts, results, tokenize_lines_compact);
+    run("tokenize-compressed/" + corpus.name, corpus, opts, results, tokenize_lines_compressed);
+    run("tokenize-buffer/" + corpus.name, corpus, opts, results, tokenize_buffer);
+    run("scan-includes/" + corpus.name, corpus, opts, results, scan_includes);
+
+    if (selected(opts, "load-stream/" + corpus.name))
+    {
+      const TemporaryDirectory dir;
+      const std::string path = write_stream(corpus, dir);
+      run("load-stream/" + corpus.name, corpus, opts, results, [&](const Corpus& c, size_t& memory) {
+        return load_stream(path, c, memory);
+        });
+    }
+
+    if (selected(opts, "tokenize-cached/" + corpus.name))
+    {
+      const TemporaryDirectory dir;
+      cpptok::TokenCache cache{ dir.path("cache") };
+      cache.tokenize(corpus.text);
+      run("tokenize-cached/" + corpus.name, corpus, opts, results, [&](const Corpus& c, size_t& memory) {
+        return tokenize_cached(cache, c, memory);
+        });
+    }
+
+    const std::vector<std::string_view> files = split_corpus(corpus);
+    run("tokenize-batch/" + corpus.name, corpus, opts, results, [&](const Corpus&, size_t& memory) {
+      return tokenize_batch(batch, files, memory);
+      });
+    run("tokenize-chunked/" + corpus.name, corpus, opts, results, [&](const Corpus& c, size_t& memory) {
+      return tokenize_chunked(batch, c, memory);
+      });
+  }
+}
+
+} // namespace bench
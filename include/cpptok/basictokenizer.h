@@ -0,0 +1,1283 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_BASICTOKENIZER_H
+#define CPPTOK_BASICTOKENIZER_H
+
+#include "cpptok/token.h"
+#include "cpptok/identifiertable.h"
+#include "cpptok/scan.h"
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+namespace details
+{
+
+struct Keyword {
+  const char *name;
+  TokenType::Value toktype;
+};
+
+inline constexpr Keyword keywords[] = {
+  { "auto", TokenType::Auto },
+  { "bool", TokenType::Bool },
+  { "break", TokenType::Break },
+  { "case", TokenType::Case },
+  { "catch", TokenType::Catch },
+  { "char", TokenType::Char },
+  { "class", TokenType::Class },
+  { "const", TokenType::Const },
+  { "const_cast", TokenType::ConstCast },
+  { "constexpr", TokenType::Constexpr },
+  { "continue", TokenType::Continue },
+  { "decltype", TokenType::Decltype },
+  { "default", TokenType::Default },
+  { "delete", TokenType::Delete },
+  { "do", TokenType::Do },
+  { "double", TokenType::Double },
+  { "dynamic_cast", TokenType::DynamicCast },
+  { "else", TokenType::Else },
+  { "enum", TokenType::Enum },
+  { "explicit", TokenType::Explicit },
+  { "export", TokenType::Export },
+  { "extern", TokenType::Extern },
+  { "false", TokenType::False },
+  { "final", TokenType::Final },
+  { "float", TokenType::Float },
+  { "for", TokenType::For },
+  { "friend", TokenType::Friend },
+  { "goto", TokenType::Goto },
+  { "if", TokenType::If },
+  { "import", TokenType::Import },
+  { "inline", TokenType::Inline },
+  { "int", TokenType::Int },
+  { "long", TokenType::Long },
+  { "mutable", TokenType::Mutable },
+  { "namespace", TokenType::Namespace },
+  { "noexcept", TokenType::Noexcept },
+  { "nullptr", TokenType::Nullptr },
+  { "operator", TokenType::Operator },
+  { "override", TokenType::Override },
+  { "private", TokenType::Private },
+  { "protected", TokenType::Protected },
+  { "public", TokenType::Public },
+  { "reinterpret_cast", TokenType::ReinterpretCast },
+  { "return", TokenType::Return },
+  { "sizeof", TokenType::Sizeof },
+  { "static", TokenType::Static },
+  { "static_assert", TokenType::StaticAssert },
+  { "static_cast", TokenType::StaticCast },
+  { "struct", TokenType::Struct },
+  { "switch", TokenType::Switch },
+  { "template", TokenType::Template },
+  { "this", TokenType::This },
+  { "throw", TokenType::Throw },
+  { "true", TokenType::True },
+  { "try", TokenType::Try },
+  { "typedef", TokenType::Typedef },
+  { "typeid", TokenType::Typeid },
+  { "typename", TokenType::Typename },
+  { "unsigned", TokenType::Unsigned },
+  { "using", TokenType::Using },
+  { "virtual", TokenType::Virtual },
+  { "void", TokenType::Void },
+  { "while", TokenType::While },
+};
+
+inline constexpr size_t keyword_max_length = 16;
+
+constexpr size_t keyword_length(const char* str)
+{
+  size_t n = 0;
+  while (str[n] != '\0')
+    ++n;
+  return n;
+}
+
+/*
+ * Keywords are looked up in a perfect hash table indexed by a hash of the
+ * length and of the first, second and last characters of the identifier.
+ * Every identifier therefore costs a single probe and at most one memcmp().
+ * The multipliers were chosen so that no two keywords collide, which is
+ * checked at compile time below.
+ */
+
+inline constexpr size_t keyword_table_size = 256;
+
+constexpr size_t keyword_hash(const char* str, size_t length)
+{
+  return (length * 7
+    + static_cast<unsigned char>(str[0]) * 9
+    + static_cast<unsigned char>(str[1])
+    + static_cast<unsigned char>(str[length - 1]) * 25) & (keyword_table_size - 1);
+}
+
+struct KeywordSlot {
+  const char *name = nullptr;
+  size_t length = 0;
+  TokenType::Value toktype = TokenType::UserDefinedName;
+};
+
+struct KeywordTable {
+  KeywordSlot slots[keyword_table_size] = {};
+  bool collision = false;
+};
+
+constexpr KeywordTable build_keyword_table()
+{
+  KeywordTable table;
+
+  for (const Keyword& k : keywords)
+  {
+    const size_t length = keyword_length(k.name);
+    KeywordSlot& slot = table.slots[keyword_hash(k.name, length)];
+
+    if (slot.name != nullptr || length > keyword_max_length)
+      table.collision = true;
+
+    slot.name = k.name;
+    slot.length = length;
+    slot.toktype = k.toktype;
+  }
+
+  return table;
+}
+
+inline constexpr KeywordTable keyword_table = build_keyword_table();
+
+static_assert(!keyword_table.collision, "keyword_hash() is not a perfect hash for the keywords");
+
+
+struct OperatorLexeme {
+  const char *name;
+  TokenType::Value toktype;
+};
+
+inline constexpr OperatorLexeme operators[] = {
+  { "+", TokenType::Plus },
+  { "-", TokenType::Minus },
+  { "!", TokenType::LogicalNot },
+  { "~", TokenType::BitwiseNot },
+  { "*", TokenType::Mul },
+  { "/", TokenType::Div },
+  { "%", TokenType::Remainder },
+  { "<", TokenType::Less },
+  { ">", TokenType::GreaterThan },
+  { "&", TokenType::BitwiseAnd },
+  { "^", TokenType::BitwiseXor },
+  { "|", TokenType::BitwiseOr },
+  { "=", TokenType::Eq },
+  { "++", TokenType::PlusPlus },
+  { "--", TokenType::MinusMinus },
+  { "<<", TokenType::LeftShift },
+  { ">>", TokenType::RightShift },
+  { "<=", TokenType::LessEqual },
+  { ">=", TokenType::GreaterThanEqual },
+  { "==", TokenType::EqEq },
+  { "!=", TokenType::Neq },
+  { "&&", TokenType::LogicalAnd },
+  { "||", TokenType::LogicalOr },
+  { "*=", TokenType::MulEq },
+  { "/=", TokenType::DivEq },
+  { "%=", TokenType::RemainderEq },
+  { "+=", TokenType::AddEq },
+  { "-=", TokenType::SubEq },
+  { "&=", TokenType::BitAndEq },
+  { "|=", TokenType::BitOrEq },
+  { "^=", TokenType::BitXorEq },
+  { "<<=", TokenType::LeftShiftEq },
+  { ">>=", TokenType::RightShiftEq },
+};
+
+/*
+ * Operators are recognized by a DFA built at compile time from the table
+ * above: a trie whose states are indexed by the sequence of characters read
+ * so far. The longest operator is found in a single forward pass with one
+ * table lookup per character.
+ * State 0 is the initial state, and is also used to signal the absence of
+ * a transition since no transition leads back to it.
+ */
+
+inline constexpr size_t operator_dfa_max_states = 64;
+
+struct OperatorDfa {
+  unsigned char next[operator_dfa_max_states][256] = {};
+  TokenType::Value accept[operator_dfa_max_states] = {};
+  size_t size = 1;
+  bool valid = true;
+};
+
+constexpr OperatorDfa build_operator_dfa()
+{
+  OperatorDfa dfa;
+
+  for (const OperatorLexeme& op : operators)
+  {
+    size_t state = 0;
+
+    for (const char* c = op.name; *c != '\0'; ++c)
+    {
+      unsigned char& target = dfa.next[state][static_cast<unsigned char>(*c)];
+
+      if (target == 0)
+      {
+        if (dfa.size == operator_dfa_max_states)
+          return dfa.valid = false, dfa;
+
+        target = static_cast<unsigned char>(dfa.size++);
+      }
+
+      state = target;
+    }
+
+    dfa.accept[state] = op.toktype;
+  }
+
+  // readOperator() never backtracks, which requires every prefix of an 
+  // operator to be an operator itself.
+  for (size_t state(1); state < dfa.size; ++state)
+  {
+    if (dfa.accept[state] == TokenType::Invalid)
+      dfa.valid = false;
+  }
+
+  return dfa;
+}
+
+inline constexpr OperatorDfa operator_dfa = build_operator_dfa();
+
+static_assert(operator_dfa.valid, "every prefix of an operator must be an operator");
+
+} // namespace details
+
+/*!
+ * \class TokenizerBase
+ * \brief the part of the tokenizers that does not depend on the sink
+ */
+
+class TokenizerBase
+{
+public:
+
+  /*!
+   * \enum State
+   * \brief describes the state of the tokenizer
+   */
+  enum State
+  {
+    /*!
+     * \value Default
+     * \brief the default state
+     */
+    Default,
+    /*!
+     * \value LongComment
+     * \brief the state indicating a multi-line comment
+     */
+    LongComment,
+  };
+  /*!
+   * \endenum 
+   */
+
+public:
+  /*!
+   * \variable State state
+   * \brief describes the state of the tokenizer
+   */
+  State state = State::Default;
+
+  /*!
+   * \variable const IdentifierTable* identifiers
+   * \brief optional table used to classify identifiers
+   * 
+   * If null, identifiers are either keywords or UserDefinedName.
+   */
+  const IdentifierTable* identifiers = nullptr;
+
+public:
+  enum CharacterType {
+    Invalid,
+    Space,
+    Letter,
+    Digit,
+    Dot,
+    SingleQuote,
+    DoubleQuote,
+    LeftPar,
+    RightPar,
+    LeftBrace,
+    RightBrace,
+    LeftBracket,
+    RightBracket,
+    Punctuator,
+    Underscore,
+    Semicolon,
+    Colon, 
+    QuestionMark,
+    Comma,
+    Tabulation,
+    LineBreak,
+    CarriageReturn,
+    Other,
+  };
+
+  static constexpr CharacterType character_types[128] = {
+    Invalid, // NUL    (Null char.)
+    Invalid, // SOH    (Start of Header)
+    Invalid, // STX    (Start of Text)
+    Invalid, // ETX    (End of Text)
+    Invalid, // EOT    (End of Transmission)
+    Invalid, // ENQ    (Enquiry)
+    Invalid, // ACK    (Acknowledgment)
+    Invalid, // BEL    (Bell)
+    Invalid, //  BS    (Backspace)
+    Tabulation, //  HT    (Horizontal Tab)
+    LineBreak, //  LF    (Line Feed)
+    Invalid, //  VT    (Vertical Tab)
+    Invalid, //  FF    (Form Feed)
+    CarriageReturn, //  CR    (Carriage Return)
+    Invalid, //  SO    (Shift Out)
+    Invalid, //  SI    (Shift In)
+    Invalid, // DLE    (Data Link Escape)
+    Invalid, // DC1    (XON)(Device Control 1)
+    Invalid, // DC2    (Device Control 2)
+    Invalid, // DC3    (XOFF)(Device Control 3)
+    Invalid, // DC4    (Device Control 4)
+    Invalid, // NAK    (Negative Acknowledgement)
+    Invalid, // SYN    (Synchronous Idle)
+    Invalid, // ETB    (End of Trans. Block)
+    Invalid, // CAN    (Cancel)
+    Invalid, //  EM    (End of Medium)
+    Invalid, // SUB    (Substitute)
+    Invalid, // ESC    (Escape)
+    Invalid, //  FS    (File Separator)
+    Invalid, //  GS    (Group Separator)
+    Invalid, //  RS    (Request to Send)(Record Separator)
+    Invalid, //  US    (Unit Separator)
+    Space, //  SP    (Space)
+    Punctuator, //   !    (exclamation mark)
+    DoubleQuote, //   "    (double quote)
+    Punctuator, //   #    (number sign)
+    Punctuator, //   $    (dollar sign)
+    Punctuator, //   %    (percent)
+    Punctuator, //   &    (ampersand)
+    SingleQuote, //   '    (single quote)
+    LeftPar, //   (    (left opening parenthesis)
+    RightPar, //   )    (right closing parenthesis)
+    Punctuator, //   *    (asterisk)
+    Punctuator, //   +    (plus)
+    Comma, //   ,    (comma)
+    Punctuator, //   -    (minus or dash)
+    Dot, //   .    (dot)
+    Punctuator, //   /    (forward slash)
+    Digit, //   0
+    Digit, //   1
+    Digit, //   2
+    Digit, //   3
+    Digit, //   4
+    Digit, //   5
+    Digit, //   6
+    Digit, //   7
+    Digit, //   8
+    Digit, //   9
+    Colon, //   :    (colon)
+    Semicolon, //   ;    (semi-colon)
+    Punctuator, //   <    (less than sign)
+    Punctuator, //   =    (equal sign)
+    Punctuator, //   >    (greater than sign)
+    QuestionMark, //   ?    (question mark)
+    Punctuator, //   @    (AT symbol)
+    Letter, //   A
+    Letter, //   B
+    Letter, //   C
+    Letter, //   D
+    Letter, //   E
+    Letter, //   F
+    Letter, //   G
+    Letter, //   H
+    Letter, //   I
+    Letter, //   J
+    Letter, //   K
+    Letter, //   L
+    Letter, //   M
+    Letter, //   N
+    Letter, //   O
+    Letter, //   P
+    Letter, //   Q
+    Letter, //   R
+    Letter, //   S
+    Letter, //   T
+    Letter, //   U
+    Letter, //   V
+    Letter, //   W
+    Letter, //   X
+    Letter, //   Y
+    Letter, //   Z
+    LeftBracket, //   [    (left opening bracket)
+    Punctuator, //   \    (back slash)
+    RightBracket, //   ]    (right closing bracket)
+    Punctuator, //   ^    (caret cirumflex)
+    Underscore, //   _    (underscore)
+    Punctuator, //   `
+    Letter, //   a
+    Letter, //   b
+    Letter, //   c
+    Letter, //   d
+    Letter, //   e
+    Letter, //   f
+    Letter, //   g
+    Letter, //   h
+    Letter, //   i
+    Letter, //   j
+    Letter, //   k
+    Letter, //   l
+    Letter, //   m
+    Letter, //   n
+    Letter, //   o
+    Letter, //   p
+    Letter, //   q
+    Letter, //   r
+    Letter, //   s
+    Letter, //   t
+    Letter, //   u
+    Letter, //   v
+    Letter, //   w
+    Letter, //   x
+    Letter, //   y
+    Letter, //   z
+    LeftBrace, //   {    (left opening brace)
+    Punctuator, //   |    (vertical bar)
+    RightBrace, //   }    (right closing brace)
+    Punctuator, //   ~    (tilde)
+    Invalid, // DEL    (delete)
+  };
+
+  static CharacterType ctype(char c);
+  inline static bool isLetter(char c) { return ctype(c) == Letter; }
+  inline static bool isDigit(char c) { return ctype(c) == Digit; }
+  inline static bool isIdentifier(char c) { return isLetter(c) || c == '_'; }
+  inline static bool isIdentifierOrDigit(char c) { return isIdentifier(c) || isDigit(c); }
+  inline static bool isBinary(char c) { return c == '0' || c == '1'; }
+  inline static bool isOctal(char c) { return '0' <= c && c <= '7'; }
+  inline static bool isDecimal(char c) { return isDigit(c); }
+  inline static bool isHexa(char c) { return isDecimal(c) || ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F'); }
+  static bool isDiscardable(char c);
+  inline static bool isSpace(char c) { return ctype(c) == Space; }
+};
+
+/*!
+ * \fn static CharacterType ctype(char c)
+ * \brief returns the type of a character
+ */
+inline TokenizerBase::CharacterType TokenizerBase::ctype(char c)
+{
+  // char may be signed, bytes above 0x7F must not be used as negative indices
+  const unsigned char uc = static_cast<unsigned char>(c);
+
+  if(uc <= 127)
+    return character_types[uc];
+  return Other;
+}
+
+/*!
+ * \fn static bool isDiscardable(char c)
+ * \brief returns whether a character is whitespace
+ */
+inline bool TokenizerBase::isDiscardable(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class BasicTokenizer
+ * \brief a tokenizer writing its tokens into a sink
+ * 
+ * BasicTokenizer contains the whole lexing logic of the library and is 
+ * parameterized by the type of its sink, which receives each token as 
+ * soon as it is read.
+ * Any type callable as \c{sink(const Token&)} can be used as a sink: 
+ * a lambda, or one of the sinks defined in cpptok/tokensinks.h.
+ * Since everything is defined in this header, the calls to the sink can be 
+ * inlined by the compiler.
+ * 
+ * \code
+ * size_t identifiers = 0;
+ * cpptok::BasicTokenizer lexer{ [&](const cpptok::Token& tok) { identifiers += tok.isIdentifier(); } };
+ * lexer.tokenize(line);
+ * \endcode
+ * 
+ * The state is handled as by Tokenizer: multi-line comments are continued 
+ * on the next call to tokenize().
+ */
+
+template<typename Sink>
+class BasicTokenizer : public TokenizerBase
+{
+public:
+  BasicTokenizer() = default;
+  explicit BasicTokenizer(Sink s);
+
+  Sink& sink();
+  const Sink& sink() const;
+
+  void tokenize(const std::string& str);
+  void tokenize(const char* str);
+  void tokenize(const char* str, size_t len);
+
+  void setInput(const std::string& str);
+  void setInput(const char* str);
+  void setInput(const char* str, size_t len);
+
+protected:
+  bool advance();
+  void read();
+  void write(const Token& tok);
+  void write(TokenType type);
+  bool atEnd() const;
+  size_t pos() const;
+  char readChar();
+  void discardChar() noexcept;
+  char charAt(size_t pos);
+  char currentChar() const;
+  inline char peekChar() const { return currentChar(); }
+  void consumeDiscardable();
+  void consumeHorizontalSpaces();
+  void consumeIdentifierChars();
+  string_view currentText() const;
+  void readNumericLiteral();
+  void readHexa();
+  void readOctal();
+  void readBinary();
+  void readDecimal();
+  void readIdentifier();
+  TokenType identifierType(size_t begin, size_t end) const;
+  void readStringLiteral();
+  void readCharLiteral();
+  TokenType getOperator(size_t begin, size_t end) const;
+  void readOperator();
+  void readColonOrColonColon();
+  void readFromPunctuator(char p);
+  void readSingleLineComment();
+  void createLongComment();
+  void readMultiLineComment();
+  bool tryReadLiteralSuffix();
+  void readPreprocessor();
+  void readIncludePath();
+
+private:
+  Sink m_sink;
+  const char* m_chars = nullptr;
+  size_t m_len = 0;
+  size_t m_pos = 0;
+  size_t m_start = 0;
+  bool m_written = false;
+  bool m_resume_comment = false;
+  bool m_read_include = false;
+};
+
+/*!
+ * \fn BasicTokenizer(Sink s)
+ * \param the sink
+ * \brief constructs a tokenizer writing into the given sink
+ */
+template<typename Sink>
+inline BasicTokenizer<Sink>::BasicTokenizer(Sink s)
+  : m_sink(std::move(s))
+{
+
+}
+
+/*!
+ * \fn Sink& sink()
+ * \brief returns the sink of the tokenizer
+ */
+template<typename Sink>
+inline Sink& BasicTokenizer<Sink>::sink()
+{
+  return m_sink;
+}
+
+/*!
+ * \fn const Sink& sink() const
+ * \brief returns the sink of the tokenizer
+ */
+template<typename Sink>
+inline const Sink& BasicTokenizer<Sink>::sink() const
+{
+  return m_sink;
+}
+
+/*!
+ * \fn void tokenize(const std::string& str)
+ * \param a string to tokenize
+ * 
+ * Warning: do not pass temporary string to this function. The output 
+ * tokens store the text as a string_view.
+ */
+template<typename Sink>
+inline void BasicTokenizer<Sink>::tokenize(const std::string& str)
+{
+  tokenize(str.data(), str.length());
+}
+
+/*!
+ * \fn void tokenize(const char* str)
+ * \param a string to tokenize
+ */
+template<typename Sink>
+inline void BasicTokenizer<Sink>::tokenize(const char* str)
+{
+  tokenize(str, std::strlen(str));
+}
+
+/*!
+ * \fn void tokenize(const char* str, size_t len)
+ * \param the string to tokenize
+ * \param the length of the string
+ * \brief writes all the tokens of the string into the sink
+ */
+template<typename Sink>
+inline void BasicTokenizer<Sink>::tokenize(const char* str, size_t len)
+{
+  setInput(str, len);
+
+  while (advance());
+}
+
+/*!
+ * \fn void setInput(const std::string& str)
+ * \param the string to read from
+ * \brief sets the input of the tokenizer without reading anything
+ *
+ * Warning: do not pass temporary string to this function. The output 
+ * tokens store the text as a string_view.
+ */
+template<typename Sink>
+inline void BasicTokenizer<Sink>::setInput(const std::string& str)
+{
+  setInput(str.data(), str.length());
+}
+
+/*!
+ * \fn void setInput(const char* str)
+ * \param the string to read from
+ * \brief sets the input of the tokenizer without reading anything
+ */
+template<typename Sink>
+inline void BasicTokenizer<Sink>::setInput(const char* str)
+{
+  setInput(str, std::strlen(str));
+}
+
+/*!
+ * \fn void setInput(const char* str, size_t len)
+ * \param the string to read from
+ * \param the length of the string
+ * \brief sets the input of the tokenizer without reading anything
+ *
+ * The state must be set before calling this function.
+ */
+template<typename Sink>
+inline void BasicTokenizer<Sink>::setInput(const char* str, size_t len)
+{
+  m_chars = str;
+  m_len = len;
+  m_pos = 0;
+  m_start = 0;
+  m_resume_comment = state == State::LongComment;
+  m_read_include = false;
+}
+
+/*
+ * Reads until one token is written into the sink or the end of the input 
+ * is reached, in which case false is returned.
+ * The continuation of a multi-line comment and the path of an include 
+ * directive are read by their own step, so that every step writes at most 
+ * one token.
+ */
+template<typename Sink>
+inline bool BasicTokenizer<Sink>::advance()
+{
+  m_written = false;
+
+  while (!m_written)
+  {
+    if (m_resume_comment)
+    {
+      m_resume_comment = false;
+      readMultiLineComment();
+    }
+    else if (m_read_include)
+    {
+      m_read_include = false;
+      readIncludePath();
+    }
+    else if (atEnd())
+    {
+      return false;
+    }
+    else
+    {
+      read();
+    }
+  }
+
+  return true;
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::read()
+{
+  consumeDiscardable();
+
+  if (atEnd())
+    return;
+
+  m_start = pos();
+
+  char c = readChar();
+  CharacterType ct = ctype(c);
+
+  switch (ct)
+  {
+  case Digit:
+    return readNumericLiteral();
+  case DoubleQuote:
+    return readStringLiteral();
+  case SingleQuote:
+    return readCharLiteral();
+  case Letter:
+  case Underscore:
+    return readIdentifier();
+  case LeftPar:
+    return write(TokenType::LeftPar);
+  case RightPar:
+    return write(TokenType::RightPar);
+  case LeftBrace:
+    return write(TokenType::LeftBrace);
+  case RightBrace:
+    return write(TokenType::RightBrace);
+  case LeftBracket:
+    return write(TokenType::LeftBracket);
+  case RightBracket:
+    return write(TokenType::RightBracket);
+  case Semicolon:
+    return write(TokenType::Semicolon);
+  case Colon:
+    return readColonOrColonColon();
+  case QuestionMark:
+    return write(TokenType::QuestionMark);
+  case Comma:
+    return write(TokenType::Comma);
+  case Dot:
+    return write(TokenType::Dot);
+  case Punctuator:
+    return readFromPunctuator(c);
+  default:
+    return write(TokenType::Invalid);
+  }
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::write(const Token& tok)
+{
+  m_written = true;
+  m_sink(tok);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::write(TokenType type)
+{
+  write(Token(type, currentText()));
+}
+
+template<typename Sink>
+inline bool BasicTokenizer<Sink>::atEnd() const
+{
+  return m_pos == m_len;
+}
+
+template<typename Sink>
+inline size_t BasicTokenizer<Sink>::pos() const
+{
+  return m_pos;
+}
+
+template<typename Sink>
+inline char BasicTokenizer<Sink>::readChar()
+{
+  return *(m_chars + m_pos++);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::discardChar() noexcept
+{
+  ++m_pos;
+}
+
+template<typename Sink>
+inline char BasicTokenizer<Sink>::charAt(size_t pos)
+{
+  return m_chars[pos];
+}
+
+template<typename Sink>
+inline char BasicTokenizer<Sink>::currentChar() const
+{
+  return *(m_chars + m_pos);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::consumeDiscardable()
+{
+  // tokens are most often separated by a single space, 
+  // for which calling the vectorized scan is not worth it
+  if (atEnd() || !isDiscardable(peekChar()))
+    return;
+
+  discardChar();
+
+  if (atEnd() || !isDiscardable(peekChar()))
+    return;
+
+  m_pos = scan::skipWhitespace(m_chars + m_pos, m_chars + m_len) - m_chars;
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::consumeHorizontalSpaces()
+{
+  while (!atEnd() && (peekChar() == ' ' || peekChar() == '\t'))
+    discardChar();
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::consumeIdentifierChars()
+{
+  // most identifiers are short, only long ones are worth the vectorized scan
+  for (int i(0); i < 8; ++i)
+  {
+    if (atEnd() || !isIdentifierOrDigit(peekChar()))
+      return;
+
+    discardChar();
+  }
+
+  m_pos = scan::skipIdentifier(m_chars + m_pos, m_chars + m_len) - m_chars;
+}
+
+template<typename Sink>
+inline string_view BasicTokenizer<Sink>::currentText() const
+{
+  return string_view(m_chars + m_start, pos() - m_start);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readNumericLiteral()
+{
+  if (atEnd()) {
+    if (charAt(m_start) == '0')
+      return write(TokenType::OctalLiteral);
+    else
+      return write(TokenType::IntegerLiteral);
+  }
+
+  char c = peekChar();
+
+  // Reading binary, octal or hexadecimal number
+  // eg. : 0b00110111
+  //       018
+  //       0xACDBE
+  if (charAt(m_start) == '0' && c != '.')
+  {
+    if (c == 'x') // hexadecimal
+      return readHexa();
+    else if (c == 'b') // binary
+      return readBinary();
+    else if (TokenizerBase::isDigit(c))// octal
+      return readOctal();
+    else // it is zero
+      return write(TokenType::OctalLiteral);
+  }
+
+  return readDecimal();
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readHexa()
+{
+  [[maybe_unused]] const char x = readChar();
+  assert(x == 'x');
+
+  if (atEnd())  // input ends with '0x' -> error
+    return write(TokenType::Invalid);
+
+  while (!atEnd() && TokenizerBase::isHexa(peekChar()))
+    readChar();
+
+  if (pos() - m_start == 2) // e.g. 0x+
+    return write(TokenType::Invalid);
+  
+  return write(TokenType::HexadecimalLiteral);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readOctal()
+{
+  while (!atEnd() && TokenizerBase::isOctal(peekChar()))
+    readChar();
+
+  return write(TokenType::OctalLiteral);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readBinary()
+{
+  [[maybe_unused]] const char b = readChar();
+  assert(b == 'b');
+
+  if (atEnd())  // input ends with '0b' -> error
+    return write(TokenType::Invalid);
+
+  while (!atEnd() && TokenizerBase::isBinary(peekChar()))
+    readChar();
+
+  return write(TokenType::BinaryLiteral);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readDecimal()
+{
+  // Reading decimal numbers
+  // eg. : 25
+  //       3.14
+  //       3.14f
+  //       100e100
+  //       6.02e23
+  //       6.67e-11
+
+  while (!atEnd() && TokenizerBase::isDigit(peekChar()))
+    readChar();
+
+  if (atEnd())
+    return write(TokenType::IntegerLiteral);
+
+  bool is_decimal = false;
+
+  if (peekChar() == '.')
+  {
+    readChar();
+    is_decimal = true;
+
+    while (!atEnd() && TokenizerBase::isDigit(peekChar()))
+      readChar();
+
+    if (atEnd())
+      return write(TokenType::DecimalLiteral);
+  }
+
+  if (peekChar() == 'e')
+  {
+    readChar();
+    is_decimal = true;
+
+    if (atEnd())
+      return write(TokenType::Invalid);
+
+    if (peekChar() == '+' || peekChar() == '-')
+    {
+      readChar();
+      if (atEnd())
+        return write(TokenType::Invalid);
+    }
+
+    while (!atEnd() && TokenizerBase::isDigit(peekChar()))
+      readChar();
+
+    if (atEnd())
+      return write(TokenType::DecimalLiteral);
+  }
+
+
+  if (peekChar() == 'f') // eg. 125.f
+  {
+    readChar();
+    is_decimal = true;
+  }
+  else
+  {
+    if (tryReadLiteralSuffix())
+      return write(TokenType::UserDefinedLiteral);
+  }
+
+  return write(is_decimal ? TokenType::DecimalLiteral : TokenType::IntegerLiteral);
+}
+
+template<typename Sink>
+inline bool BasicTokenizer<Sink>::tryReadLiteralSuffix()
+{
+  auto cpos = pos();
+
+  if (!this->atEnd() && (TokenizerBase::isLetter(peekChar()) || peekChar() == '_'))
+    readChar();
+  else
+    return false;
+
+  consumeIdentifierChars();
+
+  const bool read = (cpos != pos());
+  return read;
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readPreprocessor()
+{
+  consumeHorizontalSpaces();
+
+  if (atEnd() || !isIdentifier(peekChar()))
+    return write(TokenType::Invalid);
+
+  consumeIdentifierChars();
+
+  // the path of an include directive is read by the next call to next()
+  m_read_include = currentText() == "#include";
+
+  return write(TokenType::Preproc);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readIncludePath()
+{
+  consumeHorizontalSpaces();
+  m_start = pos();
+
+  if (atEnd() || (peekChar() != '<' && peekChar() != '"'))
+    return;
+
+  char c = readChar();
+  c = c == '<' ? '>' : '"';
+
+  while (!atEnd() && peekChar() != c && peekChar() != '\n')
+    readChar();
+
+  if (atEnd() || peekChar() == '\n')
+    return write(TokenType::Invalid);
+
+  readChar();
+
+  return write(TokenType::Include);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readIdentifier()
+{
+  consumeIdentifierChars();
+
+  return write(identifierType(m_start, pos()));
+}
+
+template<typename Sink>
+inline TokenType BasicTokenizer<Sink>::identifierType(size_t begin, size_t end) const
+{
+  const char *str = m_chars + begin;
+  const size_t l = end - begin;
+
+  if (this->identifiers)
+    return this->identifiers->lookup(str, l);
+
+  if (l < 2 || l > details::keyword_max_length)
+    return TokenType::UserDefinedName;
+
+  const details::KeywordSlot& slot = details::keyword_table.slots[details::keyword_hash(str, l)];
+
+  if (slot.length == l && std::memcmp(slot.name, str, l) == 0)
+    return slot.toktype;
+
+  return TokenType::UserDefinedName;
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readStringLiteral()
+{
+  for (;;)
+  {
+    m_pos = scan::findFirstOf(m_chars + m_pos, m_chars + m_len, '"', '\\', '\n') - m_chars;
+
+    if (atEnd() || peekChar() == '"')
+      break;
+
+    if (peekChar() == '\n')
+      return write(TokenType::Invalid);
+
+    assert(peekChar() == '\\');
+    readChar();
+    if (!atEnd())
+      readChar();
+  }
+
+  if(atEnd())
+    return write(TokenType::Invalid);
+
+  assert(peekChar() == '"');
+  readChar();
+
+  if (tryReadLiteralSuffix())
+    return write(TokenType::UserDefinedLiteral);
+  
+  return write(TokenType::StringLiteral);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readCharLiteral()
+{
+  if(atEnd() || peekChar() == '\n')
+    return write(TokenType::Invalid);
+
+  readChar();
+
+  if (atEnd())
+    return write(TokenType::Invalid);
+
+  if(ctype(readChar()) != SingleQuote)
+    return write(TokenType::Invalid);
+
+  return write(TokenType::StringLiteral);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readFromPunctuator(char p)
+{
+  if (p == '/')
+  {
+    if (atEnd())
+      return write(TokenType::Div);
+    if (peekChar() == '/')
+      return readSingleLineComment();
+    else if (peekChar() == '*')
+      return readMultiLineComment();
+    else
+      return readOperator();
+  }
+  else if (p == '#')
+  {
+    return readPreprocessor();
+  }
+  
+  return readOperator();
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readColonOrColonColon()
+{
+  if (atEnd())
+    return write(TokenType::Colon);
+
+  if (peekChar() == ':')
+  {
+    readChar();
+    return write(TokenType::ScopeResolution);
+  }
+
+  return write(TokenType::Colon);
+}
+
+template<typename Sink>
+inline TokenType BasicTokenizer<Sink>::getOperator(size_t begin, size_t end) const
+{
+  size_t state = 0;
+
+  for (size_t i(begin); i < end; ++i)
+  {
+    state = details::operator_dfa.next[state][static_cast<unsigned char>(m_chars[i])];
+
+    if (state == 0)
+      return TokenType::Invalid;
+  }
+
+  return details::operator_dfa.accept[state];
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readOperator()
+{
+  size_t state = details::operator_dfa.next[0][static_cast<unsigned char>(charAt(m_start))];
+
+  if (state == 0)
+    return write(TokenType::Invalid);
+
+  while (!atEnd())
+  {
+    const size_t next = details::operator_dfa.next[state][static_cast<unsigned char>(peekChar())];
+
+    if (next == 0)
+      break;
+
+    state = next;
+    discardChar();
+  }
+
+  return write(details::operator_dfa.accept[state]);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readSingleLineComment()
+{
+  readChar(); // reads the second '/'
+
+  const void* lf = std::memchr(m_chars + m_pos, '\n', m_len - m_pos);
+  m_pos = lf ? static_cast<const char*>(lf) - m_chars : m_len;
+
+  return write(TokenType::SingleLineComment);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::createLongComment()
+{
+  state = State::LongComment;
+  return write(TokenType::MultiLineComment);
+}
+
+template<typename Sink>
+inline void BasicTokenizer<Sink>::readMultiLineComment()
+{
+  if(state == State::Default)
+    readChar(); // reads the '*' after opening '/'
+
+  const char* closing = scan::findPair(m_chars + m_pos, m_chars + m_len, '*', '/');
+
+  if (closing == m_chars + m_len)
+  {
+    m_pos = m_len;
+    return createLongComment();
+  }
+
+  m_pos = (closing - m_chars) + 2; // reads up to the closing '/'
+  state = State::Default;
+  return write(TokenType::MultiLineComment);
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_BASICTOKENIZER_H
@@ -0,0 +1,69 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_BATCHTOKENIZER_H
+#define CPPTOK_BATCHTOKENIZER_H
+
+#include "cpptok/sourcefile.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class BatchTokenizer
+ * \brief tokenizes many inputs in parallel
+ *
+ * A BatchTokenizer owns a pool of threads, each with its own Tokenizer,
+ * that is reused across calls.
+ * Inputs are dispatched largest first over per-thread queues and idle
+ * threads steal work from the others, so that a few large files do not
+ * end up being processed last.
+ *
+ * Results are always returned in the order of the inputs.
+ */
+
+class CPPTOK_API BatchTokenizer
+{
+public:
+  explicit BatchTokenizer(size_t threads = 0);
+  BatchTokenizer(const BatchTokenizer&) = delete;
+  ~BatchTokenizer();
+
+  size_t threadCount() const;
+
+  std::vector<TokenizedFile> tokenizeFiles(const std::vector<std::string>& paths);
+  std::vector<TokenBuffer> tokenizeBuffers(const std::vector<string_view>& buffers);
+
+  static constexpr size_t DefaultChunkSize = 1024 * 1024;
+  TokenBuffer tokenizeChunked(string_view buffer, size_t chunk_size = DefaultChunkSize);
+
+  void run(const std::vector<size_t>& sizes, const std::function<void(Tokenizer&, size_t)>& task);
+
+  BatchTokenizer& operator=(const BatchTokenizer&) = delete;
+
+private:
+  class Pool;
+  std::unique_ptr<Pool> m_pool;
+};
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_BATCHTOKENIZER_H
@@ -0,0 +1,172 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_BRACKETINDEX_H
+#define CPPTOK_BRACKETINDEX_H
+
+#include "cpptok/token.h"
+
+#include <utility>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class BracketIndex
+ * \brief pairs matching parentheses, brackets and braces
+ *
+ * A BracketIndex is fed with tokens in order and stores, for each of them,
+ * the index of the matching bracket, so that a parser can skip over a 
+ * parenthesized expression or a block in constant time.
+ *
+ * A closing bracket that does not match the last opened one is unbalanced
+ * and is ignored; opening brackets that are never closed are unbalanced.
+ *
+ * BracketIndex can be used as the sink of a BasicTokenizer, or be attached 
+ * to a Tokenizer through its \c brackets member.
+ */
+
+class BracketIndex
+{
+public:
+  static constexpr size_t NotABracket = size_t(-1);
+  static constexpr size_t Unbalanced = size_t(-2);
+
+  void push(TokenType type);
+  void operator()(const Token& tok) { push(tok.type()); }
+
+  size_t size() const;
+  size_t partner(size_t i) const;
+  bool isUnbalanced(size_t i) const;
+  bool isBalanced() const;
+  size_t depth() const;
+
+  void clear();
+
+private:
+  std::vector<size_t> m_partners;
+  std::vector<std::pair<size_t, TokenType::Value>> m_open;
+  size_t m_unmatched_closers = 0;
+};
+
+/*!
+ * \fn void push(TokenType type)
+ * \param the type of the next token
+ * \brief adds a token to the index
+ */
+inline void BracketIndex::push(TokenType type)
+{
+  const size_t i = m_partners.size();
+
+  switch (type.value())
+  {
+  case TokenType::LeftPar:
+    m_open.emplace_back(i, TokenType::RightPar);
+    m_partners.push_back(Unbalanced);
+    return;
+  case TokenType::LeftBracket:
+    m_open.emplace_back(i, TokenType::RightBracket);
+    m_partners.push_back(Unbalanced);
+    return;
+  case TokenType::LeftBrace:
+    m_open.emplace_back(i, TokenType::RightBrace);
+    m_partners.push_back(Unbalanced);
+    return;
+  case TokenType::RightPar:
+  case TokenType::RightBracket:
+  case TokenType::RightBrace:
+    if (!m_open.empty() && m_open.back().second == type.value())
+    {
+      const size_t j = m_open.back().first;
+      m_open.pop_back();
+      m_partners[j] = i;
+      m_partners.push_back(j);
+    }
+    else
+    {
+      ++m_unmatched_closers;
+      m_partners.push_back(Unbalanced);
+    }
+    return;
+  default:
+    m_partners.push_back(NotABracket);
+    return;
+  }
+}
+
+/*!
+ * \fn size_t size() const
+ * \brief returns the number of tokens in the index
+ */
+inline size_t BracketIndex::size() const
+{
+  return m_partners.size();
+}
+
+/*!
+ * \fn size_t partner(size_t i) const
+ * \brief returns the index of the bracket matching the i-th token
+ *
+ * Returns NotABracket if the token is not a bracket, and Unbalanced if 
+ * it has no matching bracket (yet).
+ */
+inline size_t BracketIndex::partner(size_t i) const
+{
+  return m_partners[i];
+}
+
+/*!
+ * \fn bool isUnbalanced(size_t i) const
+ * \brief returns whether the i-th token is a bracket without a match
+ */
+inline bool BracketIndex::isUnbalanced(size_t i) const
+{
+  return m_partners[i] == Unbalanced;
+}
+
+/*!
+ * \fn bool isBalanced() const
+ * \brief returns whether all the brackets have a match
+ */
+inline bool BracketIndex::isBalanced() const
+{
+  return m_open.empty() && m_unmatched_closers == 0;
+}
+
+/*!
+ * \fn size_t depth() const
+ * \brief returns the number of brackets currently open
+ */
+inline size_t BracketIndex::depth() const
+{
+  return m_open.size();
+}
+
+/*!
+ * \fn void clear()
+ * \brief removes all tokens from the index
+ */
+inline void BracketIndex::clear()
+{
+  m_partners.clear();
+  m_open.clear();
+  m_unmatched_closers = 0;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_BRACKETINDEX_H
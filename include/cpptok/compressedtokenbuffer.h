@@ -0,0 +1,324 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_COMPRESSEDTOKENBUFFER_H
+#define CPPTOK_COMPRESSEDTOKENBUFFER_H
+
+#include "cpptok/tokenbuffer.h"
+
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class CompressedTokenBuffer
+ * \brief a compressed container of tokens
+ *
+ * A CompressedTokenBuffer stores tokens that all come from the same source
+ * string, in increasing order of offset and without overlap (as produced
+ * by the Tokenizer).
+ * Each token is stored as its type code (see TokenType::code()), 1 byte,
+ * followed in a separate byte stream by the distance from the end of the
+ * previous token and the length of the token, both as varints.
+ * Since tokens are mostly adjacent, a token typically takes 3 bytes, instead
+ * of 7 bytes in a TokenBuffer and 24 bytes in a std::vector<Token>.
+ * memoryUsage() reports more while the buffer grows, as it includes the
+ * unused capacity of the vectors.
+ *
+ * Tokens are grouped in blocks of BlockSize tokens; the position of each
+ * block in the byte stream and the end of the token preceding it are stored,
+ * so that accessing a token by index decodes at most BlockSize tokens.
+ * Iterating over the buffer decodes each token once.
+ *
+ * As with Token, the source string must outlive the buffer.
+ */
+
+class CPPTOK_API CompressedTokenBuffer
+{
+public:
+  CompressedTokenBuffer() = default;
+  CompressedTokenBuffer(const CompressedTokenBuffer&) = default;
+  CompressedTokenBuffer(CompressedTokenBuffer&&) noexcept = default;
+  ~CompressedTokenBuffer() = default;
+
+  explicit CompressedTokenBuffer(string_view source);
+
+  static constexpr size_t BlockSize = 64;
+
+  string_view source() const;
+  void setSource(string_view source);
+
+  size_t size() const;
+  bool empty() const;
+  void reserve(size_t n);
+  void clear();
+  void shrink_to_fit();
+
+  void push_back(const Token& tok);
+  void push_back(TokenType type, size_t offset, size_t length);
+  void append(const std::vector<Token>& tokens);
+  void append(const TokenBuffer& tokens);
+
+  TokenType type(size_t i) const;
+  size_t offset(size_t i) const;
+  size_t length(size_t i) const;
+  string_view text(size_t i) const;
+
+  Token at(size_t i) const;
+  Token operator[](size_t i) const;
+
+  size_t memoryUsage() const;
+
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Token;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Token;
+
+    const_iterator() = default;
+    const_iterator(const CompressedTokenBuffer* buffer, size_t index);
+
+    Token operator*() const { return Token(m_buffer->type(m_index), string_view(m_buffer->m_source.data() + m_offset, m_length)); }
+
+    const_iterator& operator++();
+    const_iterator operator++(int) { const_iterator copy{ *this }; ++(*this); return copy; }
+
+    bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+    bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+
+    size_t index() const { return m_index; }
+    size_t offset() const { return m_offset; }
+    size_t length() const { return m_length; }
+
+  private:
+    void decode();
+
+  private:
+    const CompressedTokenBuffer* m_buffer = nullptr;
+    size_t m_index = 0;
+    const unsigned char* m_data = nullptr;
+    size_t m_offset = 0;
+    size_t m_length = 0;
+  };
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  CompressedTokenBuffer& operator=(const CompressedTokenBuffer&) = default;
+  CompressedTokenBuffer& operator=(CompressedTokenBuffer&&) noexcept = default;
+
+private:
+  struct Block
+  {
+    size_t data; // position of the first token of the block in m_data
+    size_t offset; // end of the token preceding the block
+  };
+
+  static size_t readVarint(const unsigned char*& p);
+  void writeVarint(size_t n);
+  void decode(size_t i, size_t& offset, size_t& length) const;
+
+private:
+  string_view m_source;
+  std::vector<unsigned char> m_types;
+  std::vector<unsigned char> m_data;
+  std::vector<Block> m_blocks;
+  size_t m_end = 0;
+};
+
+/*!
+ * \fn CompressedTokenBuffer(string_view source)
+ * \param the source string
+ * \brief constructs an empty buffer for tokens of the given source
+ */
+inline CompressedTokenBuffer::CompressedTokenBuffer(string_view source)
+  : m_source(source)
+{
+
+}
+
+/*!
+ * \fn string_view source() const
+ * \brief returns the source string of the tokens
+ */
+inline string_view CompressedTokenBuffer::source() const
+{
+  return m_source;
+}
+
+/*!
+ * \fn size_t size() const
+ * \brief returns the number of tokens in the buffer
+ */
+inline size_t CompressedTokenBuffer::size() const
+{
+  return m_types.size();
+}
+
+/*!
+ * \fn bool empty() const
+ * \brief returns whether the buffer is empty
+ */
+inline bool CompressedTokenBuffer::empty() const
+{
+  return m_types.empty();
+}
+
+/*!
+ * \fn void push_back(TokenType type, size_t offset, size_t length)
+ * \param the type of the token
+ * \param the offset of the token in the source string
+ * \param the length of the token
+ * \brief appends a token to the buffer
+ *
+ * Throws std::invalid_argument if the token starts before the end of the
+ * previous token.
+ */
+inline void CompressedTokenBuffer::push_back(TokenType type, size_t offset, size_t length)
+{
+  if (offset < m_end)
+    throw std::invalid_argument("CompressedTokenBuffer: tokens must be appended in order");
+
+  if (size() % BlockSize == 0)
+    m_blocks.push_back(Block{ m_data.size(), m_end });
+
+  writeVarint(offset - m_end);
+  writeVarint(length);
+  m_types.push_back(type.code());
+  m_end = offset + length;
+}
+
+/*!
+ * \fn void push_back(const Token& tok)
+ * \param the token
+ * \brief appends a token to the buffer
+ *
+ * The text of the token must be part of the source string of the buffer.
+ */
+inline void CompressedTokenBuffer::push_back(const Token& tok)
+{
+  push_back(tok.type(), static_cast<size_t>(tok.text().data() - m_source.data()), tok.text().size());
+}
+
+/*!
+ * \fn TokenType type(size_t i) const
+ * \brief returns the type of the i-th token
+ */
+inline TokenType CompressedTokenBuffer::type(size_t i) const
+{
+  return TokenType::fromCode(m_types[i]);
+}
+
+/*!
+ * \fn Token operator[](size_t i) const
+ * \brief returns the i-th token
+ */
+inline Token CompressedTokenBuffer::operator[](size_t i) const
+{
+  size_t offset, length;
+  decode(i, offset, length);
+  return Token(type(i), string_view(m_source.data() + offset, length));
+}
+
+inline size_t CompressedTokenBuffer::readVarint(const unsigned char*& p)
+{
+  size_t n = *p & 0x7F;
+
+  for (unsigned int shift = 7; *p++ & 0x80; shift += 7)
+    n |= static_cast<size_t>(*p & 0x7F) << shift;
+
+  return n;
+}
+
+inline void CompressedTokenBuffer::writeVarint(size_t n)
+{
+  while (n >= 0x80)
+  {
+    m_data.push_back(static_cast<unsigned char>(n | 0x80));
+    n >>= 7;
+  }
+
+  m_data.push_back(static_cast<unsigned char>(n));
+}
+
+/*!
+ * \fn const_iterator(const CompressedTokenBuffer* buffer, size_t index)
+ * \brief constructs an iterator to the token at the given index
+ */
+inline CompressedTokenBuffer::const_iterator::const_iterator(const CompressedTokenBuffer* buffer, size_t index)
+  : m_buffer(buffer),
+    m_index(index)
+{
+  if (m_index >= m_buffer->size())
+    return;
+
+  // positions the iterator at the start of the block, and decodes
+  // the tokens up to the requested one
+  const Block& b = m_buffer->m_blocks[m_index / BlockSize];
+  m_data = m_buffer->m_data.data() + b.data;
+  m_offset = b.offset;
+  m_length = 0;
+
+  for (size_t k(0); k <= m_index % BlockSize; ++k)
+    decode();
+}
+
+/*!
+ * \fn const_iterator& operator++()
+ * \brief moves to the next token
+ */
+inline CompressedTokenBuffer::const_iterator& CompressedTokenBuffer::const_iterator::operator++()
+{
+  if (++m_index < m_buffer->size())
+    decode();
+
+  return *this;
+}
+
+inline void CompressedTokenBuffer::const_iterator::decode()
+{
+  m_offset += m_length + readVarint(m_data);
+  m_length = readVarint(m_data);
+}
+
+/*!
+ * \fn const_iterator begin() const
+ * \brief returns an iterator to the first token
+ */
+inline CompressedTokenBuffer::const_iterator CompressedTokenBuffer::begin() const
+{
+  return const_iterator(this, 0);
+}
+
+/*!
+ * \fn const_iterator end() const
+ * \brief returns an iterator past the last token
+ */
+inline CompressedTokenBuffer::const_iterator CompressedTokenBuffer::end() const
+{
+  return const_iterator(this, size());
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_COMPRESSEDTOKENBUFFER_H
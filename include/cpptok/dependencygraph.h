@@ -0,0 +1,125 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_DEPENDENCYGRAPH_H
+#define CPPTOK_DEPENDENCYGRAPH_H
+
+#include "cpptok/cpptok-defs.h"
+
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+class BatchTokenizer;
+
+/*!
+ * \class DependencyGraph
+ * \brief the include graph of a set of files
+ *
+ * Scanning starts from the root files and follows the resolved includes
+ * until no new file is found; each pass scans the new files in parallel
+ * with scanIncludes().
+ *
+ * Quoted includes are first searched relative to the including file, and
+ * then in the search paths; angled includes are only searched in the search
+ * paths. The preprocessor is not run: includes in conditional blocks are
+ * followed as well.
+ */
+
+class CPPTOK_API DependencyGraph
+{
+public:
+  static constexpr size_t NoFile = size_t(-1);
+
+  struct Include
+  {
+    std::string name; // as written in the directive
+    bool angled = false;
+    size_t file = NoFile; // index of the included file, if it was found
+  };
+
+  struct File
+  {
+    std::string path;
+    bool root = false; // whether the file was added with addRoot()
+    size_t size = 0;
+    std::vector<Include> includes;
+    std::string error; // empty, or the reason why the file could not be read
+  };
+
+  struct Statistics
+  {
+    size_t bytes = 0;
+    size_t includes = 0;
+    size_t unresolved = 0;
+    size_t failed = 0; // files that could not be read
+    size_t passes = 0;
+  };
+
+  void addSearchPath(const std::string& dir);
+  void addRoot(const std::string& path);
+
+  void scan(BatchTokenizer& batch);
+
+  const std::vector<File>& files() const;
+  size_t indexOf(const std::string& path) const;
+  const Statistics& statistics() const;
+
+  std::vector<size_t> dependencies(size_t file) const;
+
+  void writeMakefile(std::ostream& out) const;
+  void writeJson(std::ostream& out) const;
+
+  static bool isSourceFile(const std::string& path);
+  static bool isTranslationUnit(const std::string& path);
+
+private:
+  size_t addFile(const std::string& path, bool root);
+  std::string resolve(const File& includer, const Include& inc) const;
+
+private:
+  std::vector<std::string> m_search_paths;
+  std::vector<File> m_files;
+  std::unordered_map<std::string, size_t> m_index;
+  size_t m_scanned = 0;
+  Statistics m_stats;
+};
+
+/*!
+ * \fn const std::vector<File>& files() const
+ * \brief returns the files of the graph
+ */
+inline const std::vector<DependencyGraph::File>& DependencyGraph::files() const
+{
+  return m_files;
+}
+
+/*!
+ * \fn const Statistics& statistics() const
+ * \brief returns statistics about the scanned files
+ */
+inline const DependencyGraph::Statistics& DependencyGraph::statistics() const
+{
+  return m_stats;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_DEPENDENCYGRAPH_H
@@ -0,0 +1,118 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_DOCUMENTTOKENIZER_H
+#define CPPTOK_DOCUMENTTOKENIZER_H
+
+#include "cpptok/tokenizer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class DocumentTokenizer
+ * \brief incrementally tokenizes an editable document
+ *
+ * The document is stored as a list of lines, each with its own tokens
+ * and the state of the Tokenizer at its start and end.
+ * When the document is edited, only the modified lines are relexed, plus
+ * the following lines until the state at the start of a line is the same
+ * as before the edit.
+ *
+ * The tokens of a line remain valid until the line is modified.
+ */
+
+class CPPTOK_API DocumentTokenizer
+{
+public:
+  DocumentTokenizer();
+  DocumentTokenizer(const DocumentTokenizer&) = delete;
+  ~DocumentTokenizer();
+
+  explicit DocumentTokenizer(string_view text);
+
+  void setText(string_view text);
+  std::string text() const;
+
+  size_t lineCount() const;
+  const std::string& line(size_t i) const;
+  const std::vector<Token>& tokens(size_t line) const;
+  Tokenizer::State stateAt(size_t line) const;
+
+  size_t replace(size_t first_line, size_t first_column, size_t last_line, size_t last_column, string_view text);
+  size_t insert(size_t line, size_t column, string_view text);
+
+  DocumentTokenizer& operator=(const DocumentTokenizer&) = delete;
+
+private:
+  size_t relex(size_t first, size_t count);
+
+private:
+  struct Line
+  {
+    std::string text;
+    std::vector<Token> tokens;
+    Tokenizer::State start_state = Tokenizer::Default;
+    Tokenizer::State end_state = Tokenizer::Default;
+  };
+
+  std::vector<std::unique_ptr<Line>> m_lines;
+  Tokenizer m_lexer;
+};
+
+/*!
+ * \fn size_t lineCount() const
+ * \brief returns the number of lines of the document
+ */
+inline size_t DocumentTokenizer::lineCount() const
+{
+  return m_lines.size();
+}
+
+/*!
+ * \fn const std::string& line(size_t i) const
+ * \brief returns the text of a line, without its newline character
+ */
+inline const std::string& DocumentTokenizer::line(size_t i) const
+{
+  return m_lines[i]->text;
+}
+
+/*!
+ * \fn const std::vector<Token>& tokens(size_t line) const
+ * \brief returns the tokens of a line
+ */
+inline const std::vector<Token>& DocumentTokenizer::tokens(size_t line) const
+{
+  return m_lines[line]->tokens;
+}
+
+/*!
+ * \fn Tokenizer::State stateAt(size_t line) const
+ * \brief returns the state of the tokenizer at the start of a line
+ */
+inline Tokenizer::State DocumentTokenizer::stateAt(size_t line) const
+{
+  return m_lines[line]->start_state;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_DOCUMENTTOKENIZER_H
@@ -0,0 +1,132 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_IDENTIFIERTABLE_H
+#define CPPTOK_IDENTIFIERTABLE_H
+
+#include "cpptok/symboltable.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class IdentifierTable
+ * \brief a runtime-extensible table for classifying identifiers
+ *
+ * An IdentifierTable maps names to token types. It initially contains the
+ * keywords known by the tokenizer, and names can be added at startup to
+ * give them one of the TokenType::UserKind0 to TokenType::UserKind7 types
+ * (e.g. for project macros or for keywords that the tokenizer does not
+ * know), or any other token type.
+ * Adding an existing name changes its type; a keyword can thus be turned
+ * back into a UserDefinedName.
+ *
+ * When a table is attached to a tokenizer through its \c identifiers member,
+ * identifiers are classified with a single lookup in the table instead of
+ * the built-in keyword table.
+ * The table must not be modified while it is used by a tokenizer.
+ */
+
+class CPPTOK_API IdentifierTable
+{
+public:
+  IdentifierTable();
+  IdentifierTable(const IdentifierTable&) = default;
+  ~IdentifierTable() = default;
+
+  void add(string_view name, TokenType type);
+  void remove(string_view name);
+  void clear();
+
+  size_t size() const;
+  TokenType lookup(string_view name) const;
+  TokenType lookup(const char* str, size_t len) const;
+
+  IdentifierTable& operator=(const IdentifierTable&) = default;
+
+private:
+  struct Slot
+  {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    TokenType::Value type = TokenType::UserDefinedName;
+  };
+
+  static uint32_t hash(const char* str, size_t len);
+  size_t slotIndex(const char* str, size_t len) const;
+  void insert(size_t slot, const char* str, size_t len, TokenType::Value type);
+  void rebuild(size_t capacity, size_t removed_slot);
+
+private:
+  size_t m_size = 0;
+  std::string m_names;
+  std::vector<Slot> m_slots;
+  unsigned int m_shift = 32;
+  size_t m_max_length = 0;
+};
+
+/*!
+ * \fn TokenType lookup(string_view name) const
+ * \brief returns the token type of an identifier
+ *
+ * Names that are not in the table are UserDefinedName.
+ */
+inline TokenType IdentifierTable::lookup(string_view name) const
+{
+  return lookup(name.data(), name.size());
+}
+
+/*!
+ * \fn TokenType lookup(const char* str, size_t len) const
+ * \brief returns the token type of an identifier
+ */
+inline TokenType IdentifierTable::lookup(const char* str, size_t len) const
+{
+  if (len == 0 || len > m_max_length)
+    return TokenType::UserDefinedName;
+
+  const size_t mask = m_slots.size() - 1;
+
+  for (size_t i = hash(str, len) >> m_shift; ; i = (i + 1) & mask)
+  {
+    const Slot& slot = m_slots[i];
+
+    if (slot.length == 0)
+      return TokenType::UserDefinedName;
+    else if (slot.length == len && std::memcmp(m_names.data() + slot.offset, str, len) == 0)
+      return slot.type;
+  }
+}
+
+/*
+ * Unlike the keyword hash of the tokenizer, every character of the name is
+ * used: names are supplied by the user and often differ only by a few
+ * characters (e.g. generated macro names). The table is kept at most a
+ * quarter full so that most lookups hit the right slot at the first probe.
+ */
+inline uint32_t IdentifierTable::hash(const char* str, size_t len)
+{
+  return static_cast<uint32_t>(SymbolTable::hash(string_view(str, len))) * 0x9E3779B1u;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_IDENTIFIERTABLE_H
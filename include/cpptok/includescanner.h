@@ -0,0 +1,44 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_INCLUDESCANNER_H
+#define CPPTOK_INCLUDESCANNER_H
+
+#include "cpptok/token.h"
+
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class IncludeDirective
+ * \brief describes an include directive found by scanIncludes()
+ */
+
+struct IncludeDirective
+{
+  string_view path; // the path, without the quotes or angle brackets
+  bool angled = false; // whether the path is written <path>
+  size_t offset = 0; // offset of the '#' in the source
+};
+
+/*!
+ * \endclass
+ */
+
+CPPTOK_API void scanIncludes(string_view source, std::vector<IncludeDirective>& result);
+CPPTOK_API std::vector<IncludeDirective> scanIncludes(string_view source);
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_INCLUDESCANNER_H
@@ -0,0 +1,27 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_JSON_H
+#define CPPTOK_JSON_H
+
+#include "cpptok/token.h"
+
+#include <string>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+CPPTOK_API std::string jsonEscape(string_view str);
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_JSON_H
@@ -0,0 +1,113 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_LINEINDEX_H
+#define CPPTOK_LINEINDEX_H
+
+#include "cpptok/token.h"
+
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class LineIndex
+ * \brief maps offsets in a buffer to line numbers
+ *
+ * A LineIndex stores the offset of the first character of each line
+ * of a buffer.
+ * Line and column numbers are zero-based.
+ */
+
+class CPPTOK_API LineIndex
+{
+public:
+  LineIndex() = default;
+  LineIndex(const LineIndex&) = default;
+  LineIndex(LineIndex&&) noexcept = default;
+  ~LineIndex() = default;
+
+  explicit LineIndex(string_view text);
+
+  void build(const char* str, size_t len);
+  void clear();
+
+  size_t lineCount() const;
+  size_t lineStart(size_t line) const;
+  size_t lineOf(size_t offset) const;
+  size_t columnOf(size_t offset) const;
+
+  const std::vector<size_t>& lineStarts() const;
+
+  LineIndex& operator=(const LineIndex&) = default;
+  LineIndex& operator=(LineIndex&&) noexcept = default;
+
+private:
+  std::vector<size_t> m_line_starts = { 0 };
+};
+
+/*!
+ * \fn LineIndex(string_view text)
+ * \param the text to index
+ * \brief constructs the line index of a text
+ */
+inline LineIndex::LineIndex(string_view text)
+{
+  build(text.data(), text.size());
+}
+
+/*!
+ * \fn size_t lineCount() const
+ * \brief returns the number of lines
+ *
+ * A text that ends with a newline has an empty last line.
+ */
+inline size_t LineIndex::lineCount() const
+{
+  return m_line_starts.size();
+}
+
+/*!
+ * \fn size_t lineStart(size_t line) const
+ * \brief returns the offset of the first character of a line
+ */
+inline size_t LineIndex::lineStart(size_t line) const
+{
+  return m_line_starts[line];
+}
+
+/*!
+ * \fn size_t columnOf(size_t offset) const
+ * \brief returns the column of the character at the given offset
+ */
+inline size_t LineIndex::columnOf(size_t offset) const
+{
+  return offset - lineStart(lineOf(offset));
+}
+
+/*!
+ * \fn const std::vector<size_t>& lineStarts() const
+ * \brief returns the offsets of the first character of each line
+ */
+inline const std::vector<size_t>& LineIndex::lineStarts() const
+{
+  return m_line_starts;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_LINEINDEX_H
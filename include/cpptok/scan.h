@@ -0,0 +1,64 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_SCAN_H
+#define CPPTOK_SCAN_H
+
+#include "cpptok/cpptok-defs.h"
+
+#include <cstddef>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \namespace scan
+ * \brief low-level routines for scanning runs of characters
+ *
+ * These functions are used by the Tokenizer to cross long runs of characters
+ * (whitespace, comment bodies, identifiers...) several bytes at a time.
+ * Depending on the CPU, an SSE2 or AVX2 implementation is selected at runtime;
+ * a portable scalar implementation is used otherwise.
+ */
+
+namespace scan
+{
+
+/*!
+ * \enum Implementation
+ * \brief the implementation selected at runtime
+ */
+enum class Implementation
+{
+  Scalar,
+  SSE2,
+  AVX2,
+};
+/*!
+ * \endenum
+ */
+
+CPPTOK_API Implementation implementation();
+
+CPPTOK_API const char* skipWhitespace(const char* begin, const char* end);
+CPPTOK_API const char* skipIdentifier(const char* begin, const char* end);
+CPPTOK_API const char* findFirstOf(const char* begin, const char* end, char a, char b, char c);
+CPPTOK_API const char* findFirstOf(const char* begin, const char* end, char a, char b, char c, char d);
+CPPTOK_API const char* findPair(const char* begin, const char* end, char a, char b);
+CPPTOK_API void findAll(const char* begin, const char* end, char c, std::vector<size_t>& positions);
+
+} // namespace scan
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_SCAN_H
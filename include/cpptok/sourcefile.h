@@ -0,0 +1,156 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_SOURCEFILE_H
+#define CPPTOK_SOURCEFILE_H
+
+#include "cpptok/lineindex.h"
+#include "cpptok/tokenbuffer.h"
+
+#include <memory>
+#include <string>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+class Tokenizer;
+class TokenizedFile;
+
+/*!
+ * \class SourceFile
+ * \brief a read-only memory-mapped source file
+ *
+ * The content of the file is mapped in memory rather than copied into
+ * a string.
+ * SourceFile is a lightweight handle: copies share the same mapping,
+ * which is released when the last copy is destroyed.
+ */
+
+class CPPTOK_API SourceFile
+{
+public:
+  SourceFile() = default;
+  SourceFile(const SourceFile&) = default;
+  SourceFile(SourceFile&&) noexcept = default;
+  ~SourceFile() = default;
+
+  explicit SourceFile(const std::string& path);
+
+  bool isNull() const;
+  const std::string& path() const;
+
+  const char* data() const;
+  size_t size() const;
+  string_view text() const;
+
+  TokenizedFile tokenize() const;
+  TokenizedFile tokenize(Tokenizer& lexer) const;
+
+  SourceFile& operator=(const SourceFile&) = default;
+  SourceFile& operator=(SourceFile&&) noexcept = default;
+
+private:
+  class Mapping;
+  std::shared_ptr<const Mapping> m_mapping;
+};
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class TokenizedFile
+ * \brief the tokens of a SourceFile
+ *
+ * A TokenizedFile holds a reference to the mapping of its file, so that
+ * its tokens remain valid for as long as the TokenizedFile exists.
+ */
+
+class CPPTOK_API TokenizedFile
+{
+public:
+  TokenizedFile() = default;
+  TokenizedFile(SourceFile file, TokenBuffer tokens, LineIndex lines);
+
+  const SourceFile& file() const;
+  const TokenBuffer& tokens() const;
+  const LineIndex& lines() const;
+
+  size_t lineOf(size_t i) const;
+
+private:
+  SourceFile m_file;
+  TokenBuffer m_tokens;
+  LineIndex m_lines;
+};
+
+/*!
+ * \fn bool isNull() const
+ * \brief returns whether no file is mapped
+ */
+inline bool SourceFile::isNull() const
+{
+  return m_mapping == nullptr;
+}
+
+/*!
+ * \fn string_view text() const
+ * \brief returns the content of the file
+ */
+inline string_view SourceFile::text() const
+{
+  return string_view(data(), size());
+}
+
+/*!
+ * \fn const SourceFile& file() const
+ * \brief returns the file the tokens come from
+ */
+inline const SourceFile& TokenizedFile::file() const
+{
+  return m_file;
+}
+
+/*!
+ * \fn const TokenBuffer& tokens() const
+ * \brief returns the tokens of the file
+ */
+inline const TokenBuffer& TokenizedFile::tokens() const
+{
+  return m_tokens;
+}
+
+/*!
+ * \fn const LineIndex& lines() const
+ * \brief returns the line index of the file
+ */
+inline const LineIndex& TokenizedFile::lines() const
+{
+  return m_lines;
+}
+
+/*!
+ * \fn size_t lineOf(size_t i) const
+ * \brief returns the line of the i-th token
+ */
+inline size_t TokenizedFile::lineOf(size_t i) const
+{
+  return m_lines.lineOf(m_tokens.offset(i));
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_SOURCEFILE_H
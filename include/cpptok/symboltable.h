@@ -0,0 +1,207 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_SYMBOLTABLE_H
+#define CPPTOK_SYMBOLTABLE_H
+
+#include "cpptok/token.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class SymbolTable
+ * \brief assigns integer ids to identifiers
+ *
+ * Interning a name returns a 32-bit id that is the same for every occurrence
+ * of the name, so that identifiers can be compared and used as keys without
+ * looking at their text again.
+ * The table owns a copy of the names, which therefore do not need to
+ * outlive the source string.
+ *
+ * A concurrent table can be shared by several threads (e.g. the tokenizers
+ * of a BatchTokenizer); it is split into shards, each protected by its own
+ * mutex, and ids are then not contiguous.
+ * A table that is not concurrent assigns ids 0, 1, 2... in order and does
+ * not lock.
+ */
+
+class CPPTOK_API SymbolTable
+{
+public:
+  static constexpr uint32_t NoSymbol = 0xFFFFFFFF;
+
+  explicit SymbolTable(bool concurrent = false);
+  SymbolTable(const SymbolTable&) = delete;
+  ~SymbolTable();
+
+  bool isConcurrent() const;
+
+  uint32_t intern(string_view name);
+  uint32_t intern(string_view name, uint64_t hash);
+  uint32_t find(string_view name) const;
+
+  string_view name(uint32_t id) const;
+  size_t size() const;
+
+  static uint64_t hash(string_view name);
+
+  SymbolTable& operator=(const SymbolTable&) = delete;
+
+private:
+  class Shard;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  unsigned int m_shard_bits = 0;
+};
+
+/*!
+ * \fn uint32_t intern(string_view name)
+ * \param the name
+ * \brief returns the id of a name, adding it to the table if needed
+ */
+inline uint32_t SymbolTable::intern(string_view name)
+{
+  return intern(name, hash(name));
+}
+
+/*!
+ * \fn static uint64_t hash(string_view name)
+ * \brief returns the hash used by the table
+ *
+ * The name is read 8 bytes at a time.
+ */
+inline uint64_t SymbolTable::hash(string_view name)
+{
+  constexpr uint64_t k = 0x9E3779B97F4A7C15;
+
+  const char* p = name.data();
+  size_t n = name.size();
+  uint64_t h = n * k;
+
+  for (; n >= 8; n -= 8, p += 8)
+  {
+    uint64_t w;
+    std::memcpy(&w, p, 8);
+    h = (h ^ w) * k;
+    h ^= h >> 29;
+  }
+
+  if (n > 0)
+  {
+    uint64_t w = 0;
+    std::memcpy(&w, p, n);
+    h = (h ^ w) * k;
+  }
+
+  return h ^ (h >> 32);
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class SymbolIndex
+ * \brief stores the symbol id of each token
+ *
+ * A SymbolIndex is fed with tokens in order and interns the identifiers
+ * (tokens of type UserDefinedName) in a SymbolTable; other tokens get
+ * the id SymbolTable::NoSymbol.
+ *
+ * SymbolIndex can be used as the sink of a BasicTokenizer, or be attached
+ * to a Tokenizer through its \c symbols member.
+ * Several indexes can share the same (concurrent) table.
+ */
+
+class SymbolIndex
+{
+public:
+  explicit SymbolIndex(SymbolTable& table) : m_table(&table) { }
+
+  void push(const Token& tok);
+  void operator()(const Token& tok) { push(tok); }
+
+  SymbolTable& table() const { return *m_table; }
+
+  size_t size() const;
+  uint32_t id(size_t i) const;
+  const std::vector<uint32_t>& ids() const;
+
+  void clear();
+
+private:
+  SymbolTable* m_table;
+  std::vector<uint32_t> m_ids;
+};
+
+/*!
+ * \fn void push(const Token& tok)
+ * \param the next token
+ * \brief adds a token to the index
+ */
+inline void SymbolIndex::push(const Token& tok)
+{
+  m_ids.push_back(tok == TokenType::UserDefinedName ? m_table->intern(tok.text()) : SymbolTable::NoSymbol);
+}
+
+/*!
+ * \fn size_t size() const
+ * \brief returns the number of tokens in the index
+ */
+inline size_t SymbolIndex::size() const
+{
+  return m_ids.size();
+}
+
+/*!
+ * \fn uint32_t id(size_t i) const
+ * \brief returns the symbol id of the i-th token
+ *
+ * Returns SymbolTable::NoSymbol if the token is not an identifier.
+ */
+inline uint32_t SymbolIndex::id(size_t i) const
+{
+  return m_ids[i];
+}
+
+/*!
+ * \fn const std::vector<uint32_t>& ids() const
+ * \brief returns the symbol ids of all the tokens
+ */
+inline const std::vector<uint32_t>& SymbolIndex::ids() const
+{
+  return m_ids;
+}
+
+/*!
+ * \fn void clear()
+ * \brief removes all tokens from the index
+ *
+ * The symbol table is left unchanged.
+ */
+inline void SymbolIndex::clear()
+{
+  m_ids.clear();
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_SYMBOLTABLE_H
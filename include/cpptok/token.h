@@ -180,6 +180,15 @@ public:
     MultiLineComment,
     Preproc,
     Include,
+    // identifiers classified by an IdentifierTable
+    UserKind0 = TokenCategory::Identifier | 118,
+    UserKind1,
+    UserKind2,
+    UserKind3,
+    UserKind4,
+    UserKind5,
+    UserKind6,
+    UserKind7,
     //alias
     Ampersand = BitwiseAnd,
     Ref = Ampersand,
@@ -216,8 +225,122 @@ public:
    * \brief returns the token type's value
    */
   Value value() const { return m_value; }
+
+  /*!
+   * \variable static const int CodeCount
+   * \brief number of distinct token type codes
+   */
+  static constexpr int CodeCount = 134;
+
+  unsigned char code() const;
+  static TokenType fromCode(unsigned char c);
+};
+
+namespace details
+{
+
+inline constexpr TokenType::Value token_types[TokenType::CodeCount] = {
+  TokenType::Invalid, TokenType::IntegerLiteral, TokenType::DecimalLiteral,
+  TokenType::BinaryLiteral, TokenType::OctalLiteral, TokenType::HexadecimalLiteral,
+  TokenType::StringLiteral, TokenType::LeftPar, TokenType::RightPar,
+  TokenType::LeftBracket, TokenType::RightBracket, TokenType::LeftBrace,
+  TokenType::RightBrace, TokenType::Semicolon, TokenType::Colon, TokenType::Dot,
+  TokenType::QuestionMark, TokenType::SlashSlash, TokenType::SlashStar,
+  TokenType::StarSlash, TokenType::Auto, TokenType::Bool, TokenType::Break,
+  TokenType::Case, TokenType::Catch, TokenType::Char, TokenType::Class,
+  TokenType::Const, TokenType::ConstCast, TokenType::Constexpr, TokenType::Continue,
+  TokenType::Decltype, TokenType::Default, TokenType::Delete, TokenType::Do,
+  TokenType::Double, TokenType::DynamicCast, TokenType::Else, TokenType::Enum,
+  TokenType::Explicit, TokenType::Export, TokenType::Extern, TokenType::False,
+  TokenType::Final, TokenType::Float, TokenType::For, TokenType::Friend,
+  TokenType::Goto, TokenType::If, TokenType::Import, TokenType::Inline, TokenType::Int,
+  TokenType::Long, TokenType::Mutable, TokenType::Namespace, TokenType::Noexcept,
+  TokenType::Nullptr, TokenType::Operator, TokenType::Override, TokenType::Private,
+  TokenType::Protected, TokenType::Public, TokenType::ReinterpretCast,
+  TokenType::Return, TokenType::Sizeof, TokenType::Static, TokenType::StaticAssert,
+  TokenType::StaticCast, TokenType::Struct, TokenType::Switch, TokenType::Template,
+  TokenType::This, TokenType::Throw, TokenType::True, TokenType::Try,
+  TokenType::Typedef, TokenType::Typeid, TokenType::Typename, TokenType::Unsigned,
+  TokenType::Using, TokenType::Virtual, TokenType::Void, TokenType::While,
+  TokenType::ScopeResolution, TokenType::PlusPlus, TokenType::MinusMinus,
+  TokenType::Plus, TokenType::Minus, TokenType::LogicalNot, TokenType::BitwiseNot,
+  TokenType::Mul, TokenType::Div, TokenType::Remainder, TokenType::LeftShift,
+  TokenType::RightShift, TokenType::Less, TokenType::GreaterThan, TokenType::LessEqual,
+  TokenType::GreaterThanEqual, TokenType::EqEq, TokenType::Neq, TokenType::BitwiseAnd,
+  TokenType::BitwiseOr, TokenType::BitwiseXor, TokenType::LogicalAnd,
+  TokenType::LogicalOr, TokenType::Eq, TokenType::MulEq, TokenType::DivEq,
+  TokenType::AddEq, TokenType::SubEq, TokenType::RemainderEq, TokenType::LeftShiftEq,
+  TokenType::RightShiftEq, TokenType::BitAndEq, TokenType::BitOrEq, TokenType::BitXorEq,
+  TokenType::Comma, TokenType::UserDefinedName, TokenType::UserDefinedLiteral,
+  TokenType::SingleLineComment, TokenType::LeftRightPar, TokenType::LeftRightBracket,
+  TokenType::MultiLineComment, TokenType::Preproc, TokenType::Include,
+  TokenType::UserKind0, TokenType::UserKind1, TokenType::UserKind2, TokenType::UserKind3,
+  TokenType::UserKind4, TokenType::UserKind5, TokenType::UserKind6, TokenType::UserKind7,
+};
+
+// values are made of a category (bits 16 to 20) and of an ordinal that 
+// is unique within a category (bits 0 to 6)
+constexpr size_t token_type_key(TokenType::Value v)
+{
+  return (((static_cast<size_t>(v) >> 16) & 0x1F) << 7) | (static_cast<size_t>(v) & 0x7F);
+}
+
+struct TokenTypeCodes
+{
+  unsigned char codes[0x20 << 7] = {};
 };
 
+constexpr TokenTypeCodes build_token_type_codes()
+{
+  TokenTypeCodes table;
+
+  for (int i(0); i < TokenType::CodeCount; ++i)
+    table.codes[token_type_key(token_types[i])] = static_cast<unsigned char>(i);
+
+  return table;
+}
+
+inline constexpr TokenTypeCodes token_type_codes = build_token_type_codes();
+
+constexpr bool token_type_codes_are_unique()
+{
+  for (int i(0); i < TokenType::CodeCount; ++i)
+  {
+    if (token_type_codes.codes[token_type_key(token_types[i])] != i)
+      return false;
+  }
+
+  return true;
+}
+
+static_assert(token_type_codes_are_unique(), "two token types have the same key");
+
+} // namespace details
+
+/*!
+ * \fn unsigned char code() const
+ * \brief returns a compact code for the token type
+ *
+ * Codes are dense integers in the range [0, CodeCount), 0 being the code 
+ * of TokenType::Invalid. They are used to store token types in a single byte.
+ */
+inline unsigned char TokenType::code() const
+{
+  return details::token_type_codes.codes[details::token_type_key(m_value)];
+}
+
+/*!
+ * \fn static TokenType fromCode(unsigned char c)
+ * \param the code
+ * \brief returns the token type corresponding to a code
+ *
+ * Codes outside of the [0, CodeCount) range produce TokenType::Invalid.
+ */
+inline TokenType TokenType::fromCode(unsigned char c)
+{
+  return c < CodeCount ? details::token_types[c] : Invalid;
+}
+
 inline bool operator==(const TokenType& lhs, const TokenType& rhs)
 {
   return lhs.value() == rhs.value();
@@ -0,0 +1,281 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_TOKENBUFFER_H
+#define CPPTOK_TOKENBUFFER_H
+
+#include "cpptok/token.h"
+
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class TokenBuffer
+ * \brief a compact container of tokens
+ *
+ * A TokenBuffer stores tokens that all come from the same source string
+ * as a structure of arrays: a 32-bit offset into the source, a 16-bit length
+ * and an 8-bit type code (see TokenType::code()) per token.
+ * This is 7 bytes per token instead of the 24 bytes (on 64-bit platforms)
+ * used by a std::vector<Token>.
+ *
+ * Tokens longer than 65534 characters (e.g. huge comments) have their length
+ * stored in a separate overflow table.
+ *
+ * Tokens are reconstructed on demand by operator[] or while iterating.
+ * As with Token, the source string must outlive the buffer.
+ */
+
+class CPPTOK_API TokenBuffer
+{
+public:
+  TokenBuffer() = default;
+  TokenBuffer(const TokenBuffer&) = default;
+  TokenBuffer(TokenBuffer&&) noexcept = default;
+  ~TokenBuffer() = default;
+
+  explicit TokenBuffer(string_view source);
+
+  string_view source() const;
+  void setSource(string_view source);
+
+  size_t size() const;
+  bool empty() const;
+  void reserve(size_t n);
+  void clear();
+  void shrink_to_fit();
+
+  void push_back(const Token& tok);
+  void push_back(TokenType type, size_t offset, size_t length);
+  void append(const std::vector<Token>& tokens);
+
+  TokenType type(size_t i) const;
+  size_t offset(size_t i) const;
+  size_t length(size_t i) const;
+  string_view text(size_t i) const;
+
+  Token at(size_t i) const;
+  Token operator[](size_t i) const;
+
+  size_t memoryUsage() const;
+
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Token;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Token;
+
+    const_iterator() = default;
+    const_iterator(const TokenBuffer* buffer, size_t index) : m_buffer(buffer), m_index(index) { }
+
+    Token operator*() const { return (*m_buffer)[m_index]; }
+    Token operator[](difference_type n) const { return (*m_buffer)[m_index + n]; }
+
+    const_iterator& operator++() { ++m_index; return *this; }
+    const_iterator operator++(int) { const_iterator copy{ *this }; ++m_index; return copy; }
+    const_iterator& operator--() { --m_index; return *this; }
+    const_iterator operator--(int) { const_iterator copy{ *this }; --m_index; return copy; }
+    const_iterator& operator+=(difference_type n) { m_index += n; return *this; }
+    const_iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+    const_iterator operator+(difference_type n) const { return const_iterator(m_buffer, m_index + n); }
+    const_iterator operator-(difference_type n) const { return const_iterator(m_buffer, m_index - n); }
+    difference_type operator-(const const_iterator& other) const { return difference_type(m_index) - difference_type(other.m_index); }
+
+    bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+    bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+    bool operator<(const const_iterator& other) const { return m_index < other.m_index; }
+    bool operator>(const const_iterator& other) const { return m_index > other.m_index; }
+    bool operator<=(const const_iterator& other) const { return m_index <= other.m_index; }
+    bool operator>=(const const_iterator& other) const { return m_index >= other.m_index; }
+
+    size_t index() const { return m_index; }
+
+  private:
+    const TokenBuffer* m_buffer = nullptr;
+    size_t m_index = 0;
+  };
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  TokenBuffer& operator=(const TokenBuffer&) = default;
+  TokenBuffer& operator=(TokenBuffer&&) noexcept = default;
+
+  static constexpr uint16_t LongToken = 0xFFFF;
+
+private:
+  size_t longTokenLength(size_t i) const;
+
+private:
+  string_view m_source;
+  std::vector<uint32_t> m_offsets;
+  std::vector<uint16_t> m_lengths;
+  std::vector<unsigned char> m_types;
+  std::vector<std::pair<uint32_t, size_t>> m_long_tokens;
+};
+
+/*!
+ * \fn TokenBuffer(string_view source)
+ * \param the source string
+ * \brief constructs an empty buffer for tokens of the given source
+ */
+inline TokenBuffer::TokenBuffer(string_view source)
+  : m_source(source)
+{
+
+}
+
+/*!
+ * \fn string_view source() const
+ * \brief returns the source string of the tokens
+ */
+inline string_view TokenBuffer::source() const
+{
+  return m_source;
+}
+
+/*!
+ * \fn size_t size() const
+ * \brief returns the number of tokens in the buffer
+ */
+inline size_t TokenBuffer::size() const
+{
+  return m_types.size();
+}
+
+/*!
+ * \fn bool empty() const
+ * \brief returns whether the buffer is empty
+ */
+inline bool TokenBuffer::empty() const
+{
+  return m_types.empty();
+}
+
+/*!
+ * \fn void push_back(TokenType type, size_t offset, size_t length)
+ * \param the type of the token
+ * \param the offset of the token in the source string
+ * \param the length of the token
+ * \brief appends a token to the buffer
+ */
+inline void TokenBuffer::push_back(TokenType type, size_t offset, size_t length)
+{
+  if (offset > UINT32_MAX)
+    throw std::length_error("TokenBuffer: source is too large");
+
+  m_offsets.push_back(static_cast<uint32_t>(offset));
+  m_types.push_back(type.code());
+
+  if (length < LongToken)
+  {
+    m_lengths.push_back(static_cast<uint16_t>(length));
+  }
+  else
+  {
+    m_lengths.push_back(LongToken);
+    m_long_tokens.emplace_back(static_cast<uint32_t>(m_types.size() - 1), length);
+  }
+}
+
+/*!
+ * \fn void push_back(const Token& tok)
+ * \param the token
+ * \brief appends a token to the buffer
+ *
+ * The text of the token must be part of the source string of the buffer.
+ */
+inline void TokenBuffer::push_back(const Token& tok)
+{
+  push_back(tok.type(), static_cast<size_t>(tok.text().data() - m_source.data()), tok.text().size());
+}
+
+/*!
+ * \fn TokenType type(size_t i) const
+ * \brief returns the type of the i-th token
+ */
+inline TokenType TokenBuffer::type(size_t i) const
+{
+  return TokenType::fromCode(m_types[i]);
+}
+
+/*!
+ * \fn size_t offset(size_t i) const
+ * \brief returns the offset of the i-th token in the source string
+ */
+inline size_t TokenBuffer::offset(size_t i) const
+{
+  return m_offsets[i];
+}
+
+/*!
+ * \fn size_t length(size_t i) const
+ * \brief returns the length of the i-th token
+ */
+inline size_t TokenBuffer::length(size_t i) const
+{
+  const uint16_t l = m_lengths[i];
+  return l != LongToken ? l : longTokenLength(i);
+}
+
+/*!
+ * \fn string_view text(size_t i) const
+ * \brief returns the text of the i-th token
+ */
+inline string_view TokenBuffer::text(size_t i) const
+{
+  return string_view(m_source.data() + offset(i), length(i));
+}
+
+/*!
+ * \fn Token operator[](size_t i) const
+ * \brief returns the i-th token
+ */
+inline Token TokenBuffer::operator[](size_t i) const
+{
+  return Token(type(i), text(i));
+}
+
+/*!
+ * \fn const_iterator begin() const
+ * \brief returns an iterator to the first token
+ */
+inline TokenBuffer::const_iterator TokenBuffer::begin() const
+{
+  return const_iterator(this, 0);
+}
+
+/*!
+ * \fn const_iterator end() const
+ * \brief returns an iterator past the last token
+ */
+inline TokenBuffer::const_iterator TokenBuffer::end() const
+{
+  return const_iterator(this, size());
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_TOKENBUFFER_H
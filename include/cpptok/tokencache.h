@@ -0,0 +1,103 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_TOKENCACHE_H
+#define CPPTOK_TOKENCACHE_H
+
+#include "cpptok/tokenstream.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class TokenCache
+ * \brief an on-disk cache of tokenized sources
+ *
+ * A TokenCache stores the tokens of sources as TokenStream files in a
+ * directory. Entries are keyed by the size and hash of the content of the
+ * source, so that identical files (e.g. a header vendored under several
+ * paths) share the same entry, and a modified file gets a new one.
+ *
+ * The total size of the entries is bounded: when it exceeds the maximum
+ * size, the least recently used entries are removed until it is back to
+ * 90% of the maximum size. The last use of an entry is recorded as the
+ * modification time of its file, so that it persists across runs.
+ *
+ * A TokenCache can be used by several threads; several processes may
+ * share the same directory.
+ */
+
+class CPPTOK_API TokenCache
+{
+public:
+  static constexpr uint64_t DefaultMaxSize = 256 * 1024 * 1024;
+
+  explicit TokenCache(const std::string& directory, uint64_t max_size = DefaultMaxSize);
+  TokenCache(const TokenCache&) = delete;
+  ~TokenCache() = default;
+
+  const std::string& directory() const;
+  uint64_t maxSize() const;
+  void setMaxSize(uint64_t max_size);
+  uint64_t size() const;
+
+  std::string entryPath(string_view source) const;
+
+  TokenStream find(string_view source);
+  TokenStream insert(string_view source, const TokenBuffer& tokens, const LineIndex* lines = nullptr);
+  TokenStream tokenize(string_view source);
+  TokenStream tokenize(string_view source, Tokenizer& lexer);
+
+  size_t hits() const;
+  size_t misses() const;
+
+  void evict();
+  void clear();
+
+  TokenCache& operator=(const TokenCache&) = delete;
+
+private:
+  struct Entry
+  {
+    uint64_t size;
+    uint64_t insertion; // value of m_insertions after the insert, 0 if the entry was found in the directory
+  };
+
+  std::string entryPath(uint64_t hash, size_t size) const;
+  TokenStream find(string_view source, uint64_t hash);
+  TokenStream insert(string_view source, uint64_t hash, const TokenBuffer& tokens, const LineIndex* lines);
+  void update(const std::vector<std::pair<std::string, uint64_t>>& files, uint64_t insertions);
+
+private:
+  std::string m_directory;
+  uint64_t m_max_size;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, Entry> m_entries;
+  uint64_t m_insertions = 0;
+  uint64_t m_size = 0;
+  std::atomic<size_t> m_hits{ 0 };
+  std::atomic<size_t> m_misses{ 0 };
+};
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_TOKENCACHE_H
@@ -5,8 +5,12 @@
 #ifndef CPPTOK_TOKENIZER_H
 #define CPPTOK_TOKENIZER_H
 
-#include "cpptok/token.h"
+#include "cpptok/basictokenizer.h"
+#include "cpptok/bracketindex.h"
+#include "cpptok/lineindex.h"
+#include "cpptok/symboltable.h"
 
+#include <iterator>
 #include <vector>
 
 /*!
@@ -16,6 +20,20 @@
 namespace cpptok
 {
 
+class TokenRange;
+
+namespace details
+{
+
+struct TokenSlot
+{
+  Token token;
+
+  void operator()(const Token& tok) { token = tok; }
+};
+
+} // namespace details
+
 /*!
  * \class Tokenizer
  * \brief produces token from an input string
@@ -28,46 +46,45 @@ namespace cpptok
  * The tokenize() methods provide tokenization for a variety of inputs, but ultimately 
  * an array of char* is used.
  * 
+ * Alternatively, tokenizeBuffer() tokenizes a whole file in a single call, 
+ * treating newlines as whitespace; a LineIndex can be used to map the tokens 
+ * back to lines.
+ * 
  * The output tokens are written in the \c output member of the class.
+ * The lexing itself is implemented by BasicTokenizer, which can be used 
+ * directly to send the tokens somewhere else.
+ * 
+ * Tokens can also be pulled one at a time: setInput() sets the string to 
+ * tokenize, and next() (or iterating over tokens()) reads the next token 
+ * without storing it in \c output.
  */
 
-class CPPTOK_API Tokenizer
+class CPPTOK_API Tokenizer : public BasicTokenizer<details::TokenSlot>
 {
 public:
-
-  /*!
-   * \enum State
-   * \brief describes the state of the tokenizer
-   */
-  enum State
-  {
-    /*!
-     * \value Default
-     * \brief the default state
-     */
-    Default,
-    /*!
-     * \value LongComment
-     * \brief the state indicating a multi-line comment
-     */
-    LongComment,
-  };
   /*!
-   * \endenum 
+   * \variable std::vector<Token> output
+   * \brief the tokenizer output tokens
    */
+  std::vector<Token> output;
 
-public:
   /*!
-   * \variable State state
-   * \brief describes the state of the tokenizer
+   * \variable BracketIndex* brackets
+   * \brief optional index of the matching brackets of output
+   * 
+   * If not null, the index is updated with every token appended to 
+   * \c output, so that entry i refers to the i-th output token.
    */
-  State state = State::Default;
+  BracketIndex* brackets = nullptr;
 
   /*!
-   * \variable std::vector<Token> output
-   * \brief the tokenizer output tokens
+   * \variable SymbolIndex* symbols
+   * \brief optional symbol ids of output
+   * 
+   * If not null, the identifiers appended to \c output are interned 
+   * and entry i of the index is the symbol id of the i-th output token.
    */
-  std::vector<Token> output;
+  SymbolIndex* symbols = nullptr;
 
 public:
   Tokenizer() = default;
@@ -76,83 +93,81 @@ public:
   void tokenize(const char* str);
   void tokenize(const char* str, size_t len);
 
+  void tokenizeLines(const string_view* lines, size_t count, std::vector<size_t>& offsets);
+  void tokenizeLines(const std::vector<string_view>& lines, std::vector<size_t>& offsets);
+
+  void tokenizeBuffer(const std::string& str, LineIndex* lines = nullptr);
+  void tokenizeBuffer(const char* str, size_t len, LineIndex* lines = nullptr);
+
+  bool next(Token& tok);
+  size_t fill(Token* tokens, size_t capacity);
+  TokenRange tokens();
+
   void reset();
 
-  enum CharacterType {
-    Invalid,
-    Space,
-    Letter,
-    Digit,
-    Dot,
-    SingleQuote,
-    DoubleQuote,
-    LeftPar,
-    RightPar,
-    LeftBrace,
-    RightBrace,
-    LeftBracket,
-    RightBracket,
-    Punctuator,
-    Underscore,
-    Semicolon,
-    Colon, 
-    QuestionMark,
-    Comma,
-    Tabulation,
-    LineBreak,
-    CarriageReturn,
-    Other,
-  };
-
-  static CharacterType ctype(char c);
-  inline static bool isLetter(char c) { return ctype(c) == Letter; }
-  inline static bool isDigit(char c) { return ctype(c) == Digit; }
-  inline static bool isIdentifier(char c) { return isLetter(c) || c == '_'; }
-  inline static bool isIdentifierOrDigit(char c) { return isIdentifier(c) || isDigit(c); }
-  inline static bool isBinary(char c) { return c == '0' || c == '1'; }
-  inline static bool isOctal(char c) { return '0' <= c && c <= '7'; }
-  inline static bool isDecimal(char c) { return isDigit(c); }
-  inline static bool isHexa(char c) { return isDecimal(c) || ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F'); }
-  static bool isDiscardable(char c);
-  inline static bool isSpace(char c) { return ctype(c) == Space; }
-
-protected:
-  void read();
-  void write(const Token& tok);
-  void write(TokenType type);
-  bool atEnd() const;
-  size_t pos() const;
-  char readChar();
-  void discardChar() noexcept;
-  char charAt(size_t pos);
-  char currentChar() const;
-  inline char peekChar() const { return currentChar(); }
-  void consumeDiscardable();
-  string_view currentText() const;
-  void readNumericLiteral();
-  void readHexa();
-  void readOctal();
-  void readBinary();
-  void readDecimal();
-  void readIdentifier();
-  TokenType identifierType(size_t begin, size_t end) const;
-  void readStringLiteral();
-  void readCharLiteral();
-  TokenType getOperator(size_t begin, size_t end) const;
-  void readOperator();
-  void readColonOrColonColon();
-  void readFromPunctuator(char p);
-  void readSingleLineComment();
-  void createLongComment();
-  void readMultiLineComment();
-  bool tryReadLiteralSuffix();
-  void readPreprocessor();
+private:
+  void readAll();
+};
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class TokenIterator
+ * \brief an input iterator reading tokens from a Tokenizer
+ */
+
+class TokenIterator
+{
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = Token;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const Token*;
+  using reference = const Token&;
+
+  TokenIterator() = default;
+  explicit TokenIterator(Tokenizer* tokenizer) : m_tokenizer(tokenizer) { ++(*this); }
+
+  const Token& operator*() const { return m_token; }
+  const Token* operator->() const { return &m_token; }
+
+  TokenIterator& operator++()
+  {
+    if (!m_tokenizer->next(m_token))
+      m_tokenizer = nullptr;
+
+    return *this;
+  }
+
+  bool operator==(const TokenIterator& other) const { return m_tokenizer == other.m_tokenizer; }
+  bool operator!=(const TokenIterator& other) const { return m_tokenizer != other.m_tokenizer; }
+
+private:
+  Tokenizer* m_tokenizer = nullptr;
+  Token m_token;
+};
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class TokenRange
+ * \brief a range over the remaining tokens of the input of a Tokenizer
+ */
+
+class TokenRange
+{
+public:
+  explicit TokenRange(Tokenizer* tokenizer) : m_tokenizer(tokenizer) { }
+
+  TokenIterator begin() const { return TokenIterator(m_tokenizer); }
+  TokenIterator end() const { return TokenIterator(); }
 
 private:
-  const char* m_chars = nullptr;
-  size_t m_len = 0;
-  size_t m_pos = 0;
-  size_t m_start = 0;
+  Tokenizer* m_tokenizer;
 };
 
 /*!
@@ -0,0 +1,187 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_TOKENSINKS_H
+#define CPPTOK_TOKENSINKS_H
+
+#include "cpptok/basictokenizer.h"
+#include "cpptok/tokenbuffer.h"
+
+#include <utility>
+#include <vector>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class TokenVectorSink
+ * \brief a sink appending tokens to a vector owned by the caller
+ */
+
+class TokenVectorSink
+{
+public:
+  explicit TokenVectorSink(std::vector<Token>& output) : m_output(&output) { }
+
+  void operator()(const Token& tok) { m_output->push_back(tok); }
+
+private:
+  std::vector<Token>* m_output;
+};
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class TokenBufferSink
+ * \brief a sink appending tokens to a TokenBuffer owned by the caller
+ *
+ * The input of the tokenizer must be part of the source of the buffer.
+ */
+
+class TokenBufferSink
+{
+public:
+  explicit TokenBufferSink(TokenBuffer& buffer) : m_buffer(&buffer) { }
+
+  void operator()(const Token& tok) { m_buffer->push_back(tok); }
+
+private:
+  TokenBuffer* m_buffer;
+};
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class CountingSink
+ * \brief a sink that only counts tokens
+ */
+
+class CountingSink
+{
+public:
+  void operator()(const Token& tok) { ++m_counts[tok.type().code()]; ++m_total; }
+
+  size_t count() const;
+  size_t count(TokenType type) const;
+  size_t count(TokenCategory::Value category) const;
+
+  void clear();
+
+private:
+  size_t m_counts[TokenType::CodeCount] = {};
+  size_t m_total = 0;
+};
+
+/*!
+ * \fn size_t count() const
+ * \brief returns the total number of tokens
+ */
+inline size_t CountingSink::count() const
+{
+  return m_total;
+}
+
+/*!
+ * \fn size_t count(TokenType type) const
+ * \brief returns the number of tokens of a given type
+ */
+inline size_t CountingSink::count(TokenType type) const
+{
+  return m_counts[type.code()];
+}
+
+/*!
+ * \fn size_t count(TokenCategory::Value category) const
+ * \brief returns the number of tokens of a given category
+ *
+ * Keywords are also counted as identifiers.
+ */
+inline size_t CountingSink::count(TokenCategory::Value category) const
+{
+  size_t n = 0;
+
+  for (int i(0); i < TokenType::CodeCount; ++i)
+  {
+    if ((details::token_types[i] & category) == category)
+      n += m_counts[i];
+  }
+
+  return n;
+}
+
+/*!
+ * \fn void clear()
+ * \brief resets all counts to zero
+ */
+inline void CountingSink::clear()
+{
+  *this = CountingSink();
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class FilterSink
+ * \brief a sink forwarding to another sink the tokens accepted by a predicate
+ */
+
+template<typename Pred, typename Next>
+class FilterSink
+{
+public:
+  FilterSink() = default;
+  FilterSink(Pred pred, Next next) : m_pred(std::move(pred)), m_next(std::move(next)) { }
+
+  void operator()(const Token& tok)
+  {
+    if (m_pred(tok))
+      m_next(tok);
+  }
+
+  Next& next() { return m_next; }
+  const Next& next() const { return m_next; }
+
+private:
+  Pred m_pred;
+  Next m_next;
+};
+
+/*!
+ * \endclass
+ */
+
+namespace details
+{
+
+struct IsNotComment
+{
+  bool operator()(const Token& tok) const { return !tok.isComment(); }
+};
+
+} // namespace details
+
+/*!
+ * \typedef SkipCommentsSink
+ * \brief a sink forwarding all the tokens but comments to another sink
+ */
+template<typename Next>
+using SkipCommentsSink = FilterSink<details::IsNotComment, Next>;
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_TOKENSINKS_H
@@ -0,0 +1,168 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#ifndef CPPTOK_TOKENSTREAM_H
+#define CPPTOK_TOKENSTREAM_H
+
+#include "cpptok/sourcefile.h"
+
+#include <cstdint>
+#include <iosfwd>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class TokenStream
+ * \brief a read-only, memory-mapped file of serialized tokens
+ *
+ * A token stream file stores the tokens of a source file so that they can be
+ * loaded again without lexing the source.
+ * The file starts with a fixed-size header (magic, version, size and hash
+ * of the source, number of tokens and lines) followed by columns, each
+ * aligned on 8 bytes:
+ * - the type code (see TokenType::code()) of each token, 1 byte per token;
+ * - the offset of each token in the source, 4 bytes per token;
+ * - the length of each token, 2 bytes per token, TokenBuffer::LongToken
+ *   standing for a length stored in the next column;
+ * - the (token index, length) pairs of the long tokens, 16 bytes each;
+ * - the offset of the first character of each line, 8 bytes per line.
+ *
+ * Integers are stored in the byte order of the machine that wrote the file;
+ * files written with a different byte order are rejected.
+ *
+ * Opening a TokenStream maps the file and checks the header, that every
+ * token lies within the source, and the line starts: the columns are then
+ * read in place, without being parsed or copied.
+ * The source itself is not stored; matches() checks that a source string
+ * is the one the tokens were computed from, and is needed to get the text
+ * of the tokens.
+ */
+
+class CPPTOK_API TokenStream
+{
+public:
+  TokenStream() = default;
+  TokenStream(const TokenStream&) = default;
+  TokenStream(TokenStream&&) noexcept = default;
+  ~TokenStream() = default;
+
+  explicit TokenStream(const std::string& path);
+
+  static constexpr uint32_t Version = 1;
+
+  static void write(std::ostream& out, string_view source, const TokenBuffer& tokens, const LineIndex* lines = nullptr);
+  static void write(const std::string& path, string_view source, const TokenBuffer& tokens, const LineIndex* lines = nullptr);
+  static void write(const std::string& path, const TokenizedFile& file);
+
+  static uint64_t hash(string_view source);
+
+  bool isNull() const;
+  const SourceFile& file() const;
+
+  size_t sourceSize() const;
+  uint64_t sourceHash() const;
+  bool matches(string_view source) const;
+
+  size_t size() const;
+  TokenType type(size_t i) const;
+  size_t offset(size_t i) const;
+  size_t length(size_t i) const;
+  Token token(size_t i, string_view source) const;
+
+  TokenBuffer toTokenBuffer(string_view source) const;
+
+  size_t lineCount() const;
+  size_t lineStart(size_t line) const;
+  size_t lineOf(size_t offset) const;
+
+  TokenStream& operator=(const TokenStream&) = default;
+  TokenStream& operator=(TokenStream&&) noexcept = default;
+
+private:
+  struct Header;
+  size_t longTokenLength(size_t i) const;
+
+private:
+  SourceFile m_file;
+  const Header* m_header = nullptr;
+  const unsigned char* m_types = nullptr;
+  const uint32_t* m_offsets = nullptr;
+  const uint16_t* m_lengths = nullptr;
+  const uint64_t* m_long_tokens = nullptr;
+  const uint64_t* m_line_starts = nullptr;
+};
+
+/*!
+ * \fn bool isNull() const
+ * \brief returns whether no file is opened
+ */
+inline bool TokenStream::isNull() const
+{
+  return m_header == nullptr;
+}
+
+/*!
+ * \fn const SourceFile& file() const
+ * \brief returns the mapping of the token stream file
+ */
+inline const SourceFile& TokenStream::file() const
+{
+  return m_file;
+}
+
+/*!
+ * \fn TokenType type(size_t i) const
+ * \brief returns the type of the i-th token
+ */
+inline TokenType TokenStream::type(size_t i) const
+{
+  return TokenType::fromCode(m_types[i]);
+}
+
+/*!
+ * \fn size_t offset(size_t i) const
+ * \brief returns the offset of the i-th token in the source
+ */
+inline size_t TokenStream::offset(size_t i) const
+{
+  return m_offsets[i];
+}
+
+/*!
+ * \fn size_t length(size_t i) const
+ * \brief returns the length of the i-th token
+ */
+inline size_t TokenStream::length(size_t i) const
+{
+  const uint16_t l = m_lengths[i];
+  return l != TokenBuffer::LongToken ? l : longTokenLength(i);
+}
+
+/*!
+ * \fn Token token(size_t i, string_view source) const
+ * \param the index of the token
+ * \param the source the tokens were computed from
+ * \brief returns the i-th token
+ */
+inline Token TokenStream::token(size_t i, string_view source) const
+{
+  return Token(type(i), string_view(source.data() + offset(i), length(i)));
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
+
+#endif // CPPTOK_TOKENSTREAM_H
@@ -0,0 +1,499 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/batchtokenizer.h"
+
+#include "cpptok/tokenizer.h"
+#include "cpptok/scan.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*
+ * The pool consists of threadCount() workers: the calling thread is
+ * worker 0 and the others are background threads waiting for a batch.
+ * Each worker has its own queue of job indices; a worker pops jobs from
+ * the front of its queue and steals from the back of the other queues.
+ */
+class BatchTokenizer::Pool
+{
+public:
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+    Tokenizer lexer;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable batch_started;
+  std::condition_variable batch_finished;
+  size_t generation = 0;
+  size_t busy = 0;
+  bool stopping = false;
+
+  const std::function<void(Tokenizer&, size_t)>* task = nullptr;
+  std::vector<std::exception_ptr> errors;
+
+  explicit Pool(size_t n);
+  ~Pool();
+
+  void run(const std::vector<size_t>& sizes, const std::function<void(Tokenizer&, size_t)>& fn);
+
+private:
+  void loop(size_t w);
+  void work(size_t w);
+  bool pop(size_t w, size_t& job);
+  bool steal(size_t w, size_t& job);
+};
+
+BatchTokenizer::Pool::Pool(size_t n)
+{
+  for (size_t i(0); i < n; ++i)
+    workers.push_back(std::make_unique<Worker>());
+
+  for (size_t i(1); i < n; ++i)
+    threads.emplace_back(&Pool::loop, this, i);
+}
+
+BatchTokenizer::Pool::~Pool()
+{
+  {
+    std::lock_guard<std::mutex> lock{ mutex };
+    stopping = true;
+  }
+
+  batch_started.notify_all();
+
+  for (std::thread& t : threads)
+    t.join();
+}
+
+void BatchTokenizer::Pool::run(const std::vector<size_t>& sizes, const std::function<void(Tokenizer&, size_t)>& fn)
+{
+  if (sizes.empty())
+    return;
+
+  // largest jobs first, dealt round-robin so that every queue gets a fair share
+  std::vector<size_t> order(sizes.size());
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) {
+    return sizes[a] > sizes[b];
+    });
+
+  for (size_t i(0); i < order.size(); ++i)
+    workers[i % workers.size()]->jobs.push_back(order[i]);
+
+  errors.assign(sizes.size(), nullptr);
+  task = &fn;
+
+  {
+    std::lock_guard<std::mutex> lock{ mutex };
+    busy = threads.size();
+    ++generation;
+  }
+
+  batch_started.notify_all();
+
+  work(0);
+
+  {
+    std::unique_lock<std::mutex> lock{ mutex };
+    batch_finished.wait(lock, [this]() { return busy == 0; });
+  }
+
+  task = nullptr;
+
+  for (std::exception_ptr& e : errors)
+  {
+    if (e)
+      std::rethrow_exception(e);
+  }
+}
+
+void BatchTokenizer::Pool::loop(size_t w)
+{
+  size_t seen = 0;
+
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock{ mutex };
+      batch_started.wait(lock, [&]() { return stopping || generation != seen; });
+
+      if (stopping)
+        return;
+
+      seen = generation;
+    }
+
+    work(w);
+
+    {
+      std::lock_guard<std::mutex> lock{ mutex };
+
+      if (--busy == 0)
+        batch_finished.notify_one();
+    }
+  }
+}
+
+void BatchTokenizer::Pool::work(size_t w)
+{
+  size_t job;
+
+  while (pop(w, job) || steal(w, job))
+  {
+    try
+    {
+      (*task)(workers[w]->lexer, job);
+    }
+    catch (...)
+    {
+      errors[job] = std::current_exception();
+    }
+  }
+}
+
+bool BatchTokenizer::Pool::pop(size_t w, size_t& job)
+{
+  Worker& worker = *workers[w];
+  std::lock_guard<std::mutex> lock{ worker.mutex };
+
+  if (worker.jobs.empty())
+    return false;
+
+  job = worker.jobs.front();
+  worker.jobs.pop_front();
+  return true;
+}
+
+bool BatchTokenizer::Pool::steal(size_t w, size_t& job)
+{
+  for (size_t i(1); i < workers.size(); ++i)
+  {
+    Worker& victim = *workers[(w + i) % workers.size()];
+    std::lock_guard<std::mutex> lock{ victim.mutex };
+
+    if (!victim.jobs.empty())
+    {
+      job = victim.jobs.back();
+      victim.jobs.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+struct Chunk
+{
+  string_view text;
+  std::vector<Token> tokens;
+  Tokenizer::State end_state = Tokenizer::Default;
+};
+
+static bool same_token(const Token& a, const Token& b)
+{
+  return a.type() == b.type() && a.text().data() == b.text().data() && a.text().size() == b.text().size();
+}
+
+// returns whether the line feed at the given position is escaped by a
+// backslash, i.e. whether the line continues on the next one
+static bool is_line_continuation(string_view buffer, size_t lf)
+{
+  if (lf > 0 && buffer[lf - 1] == '\\')
+    return true;
+
+  return lf > 1 && buffer[lf - 1] == '\r' && buffer[lf - 2] == '\\';
+}
+
+// returns the position after the first line feed at or after pos that
+// ends a line, or the size of the buffer
+static size_t find_line_end(string_view buffer, size_t pos)
+{
+  while (pos < buffer.size())
+  {
+    const void* lf = std::memchr(buffer.data() + pos, '\n', buffer.size() - pos);
+
+    if (!lf)
+      break;
+
+    pos = static_cast<const char*>(lf) - buffer.data();
+
+    if (!is_line_continuation(buffer, pos))
+      return pos + 1;
+
+    ++pos;
+  }
+
+  return buffer.size();
+}
+
+/*
+ * Splits a buffer into chunks that end at line boundaries.
+ * Lines continued by a backslash are not split, as a string literal
+ * or a comment may continue on the next line.
+ */
+static std::vector<Chunk> split_chunks(string_view buffer, size_t chunk_size)
+{
+  std::vector<Chunk> chunks;
+  size_t begin = 0;
+
+  while (begin < buffer.size())
+  {
+    size_t end = std::min(begin + std::max<size_t>(chunk_size, 1), buffer.size());
+    end = find_line_end(buffer, end - 1);
+
+    chunks.emplace_back();
+    chunks.back().text = buffer.substr(begin, end - begin);
+    begin = end;
+  }
+
+  return chunks;
+}
+
+/*
+ * Relexes a chunk whose predecessor ended inside a multi-line comment.
+ * Relexing stops as soon as a token identical to one produced by the
+ * speculative pass is found: from there, both passes are at the same
+ * position in the default state and thus produce the same tokens.
+ */
+static void relex_chunk(Tokenizer& lexer, Chunk& chunk)
+{
+  std::vector<Token> speculative;
+  std::swap(speculative, chunk.tokens);
+
+  lexer.state = Tokenizer::LongComment;
+  lexer.setInput(chunk.text.data(), chunk.text.size());
+
+  size_t j = 0;
+  Token tok;
+
+  while (lexer.next(tok))
+  {
+    chunk.tokens.push_back(tok);
+
+    while (j < speculative.size() && speculative[j].text().data() < tok.text().data())
+      ++j;
+
+    if (j < speculative.size() && same_token(speculative[j], tok) && lexer.state == Tokenizer::Default)
+    {
+      chunk.tokens.insert(chunk.tokens.end(), speculative.begin() + j + 1, speculative.end());
+      return;
+    }
+  }
+
+  chunk.end_state = lexer.state;
+}
+
+/*!
+ * \class BatchTokenizer
+ */
+
+/*!
+ * \fn BatchTokenizer(size_t threads)
+ * \param the number of threads, or 0 to use one thread per core
+ * \brief constructs a batch tokenizer
+ *
+ * The calling thread counts as one of the threads.
+ */
+BatchTokenizer::BatchTokenizer(size_t threads)
+{
+  if (threads == 0)
+    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+  m_pool = std::make_unique<Pool>(threads);
+}
+
+BatchTokenizer::~BatchTokenizer() = default;
+
+/*!
+ * \fn size_t threadCount() const
+ * \brief returns the number of threads used for tokenizing
+ */
+size_t BatchTokenizer::threadCount() const
+{
+  return m_pool->workers.size();
+}
+
+/*!
+ * \fn std::vector<TokenizedFile> tokenizeFiles(const std::vector<std::string>& paths)
+ * \param the paths of the files
+ * \brief maps and tokenizes files in parallel
+ *
+ * If some files cannot be mapped, the std::runtime_error of the first
+ * of them is rethrown once all the other files have been processed.
+ */
+std::vector<TokenizedFile> BatchTokenizer::tokenizeFiles(const std::vector<std::string>& paths)
+{
+  std::vector<size_t> sizes;
+  sizes.reserve(paths.size());
+
+  for (const std::string& path : paths)
+  {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    sizes.push_back(ec ? 0 : static_cast<size_t>(size));
+  }
+
+  std::vector<TokenizedFile> result{ paths.size() };
+
+  run(sizes, [&](Tokenizer& lexer, size_t i) {
+    result[i] = SourceFile(paths[i]).tokenize(lexer);
+    });
+
+  return result;
+}
+
+/*!
+ * \fn std::vector<TokenBuffer> tokenizeBuffers(const std::vector<string_view>& buffers)
+ * \param the content of the files
+ * \brief tokenizes buffers in parallel
+ *
+ * Each buffer is tokenized with Tokenizer::tokenizeBuffer().
+ * As with Token, the buffers must outlive the results.
+ */
+std::vector<TokenBuffer> BatchTokenizer::tokenizeBuffers(const std::vector<string_view>& buffers)
+{
+  std::vector<size_t> sizes;
+  sizes.reserve(buffers.size());
+
+  for (string_view buffer : buffers)
+    sizes.push_back(buffer.size());
+
+  std::vector<TokenBuffer> result{ buffers.size() };
+
+  run(sizes, [&](Tokenizer& lexer, size_t i) {
+    lexer.reset();
+    lexer.tokenizeBuffer(buffers[i].data(), buffers[i].size());
+
+    TokenBuffer& tokens = result[i];
+    tokens.setSource(buffers[i]);
+    tokens.reserve(lexer.output.size());
+    tokens.append(lexer.output);
+    });
+
+  return result;
+}
+
+/*!
+ * \fn TokenBuffer tokenizeChunked(string_view buffer, size_t chunk_size)
+ * \param the content of a file
+ * \param the approximate size of the chunks
+ * \brief tokenizes a single large buffer in parallel
+ *
+ * The buffer is split into chunks at line boundaries (excluding lines
+ * continued by a backslash), which are lexed in
+ * parallel assuming that they start in the default state.
+ * Chunks that actually start inside a multi-line comment are then relexed,
+ * only until their tokens match the speculative ones.
+ *
+ * The result is identical to the output of Tokenizer::tokenizeBuffer().
+ */
+TokenBuffer BatchTokenizer::tokenizeChunked(string_view buffer, size_t chunk_size)
+{
+  std::vector<Chunk> chunks = split_chunks(buffer, chunk_size);
+
+  std::vector<size_t> sizes;
+  sizes.reserve(chunks.size());
+
+  for (const Chunk& c : chunks)
+    sizes.push_back(c.text.size());
+
+  run(sizes, [&chunks](Tokenizer& lexer, size_t i) {
+    lexer.reset();
+    lexer.tokenizeBuffer(chunks[i].text.data(), chunks[i].text.size());
+    chunks[i].tokens = lexer.output;
+    chunks[i].end_state = lexer.state;
+    });
+
+  Tokenizer lexer;
+
+  for (size_t i(1); i < chunks.size(); ++i)
+  {
+    if (chunks[i - 1].end_state == Tokenizer::LongComment)
+      relex_chunk(lexer, chunks[i]);
+  }
+
+  size_t count = 0;
+
+  for (const Chunk& c : chunks)
+    count += c.tokens.size();
+
+  TokenBuffer result{ buffer };
+  result.reserve(count);
+
+  // a comment spanning several chunks is made of one piece per chunk,
+  // the pieces are merged into a single token
+  const char* comment_begin = nullptr;
+
+  for (const Chunk& c : chunks)
+  {
+    for (size_t k(0); k < c.tokens.size(); ++k)
+    {
+      const Token& tok = c.tokens[k];
+      const char* begin = comment_begin ? comment_begin : tok.text().data();
+
+      if (k == c.tokens.size() - 1 && c.end_state == Tokenizer::LongComment)
+      {
+        comment_begin = begin;
+      }
+      else
+      {
+        const char* end = tok.text().data() + tok.text().size();
+        result.push_back(tok.type(), begin - buffer.data(), end - begin);
+        comment_begin = nullptr;
+      }
+    }
+  }
+
+  if (comment_begin)
+    result.push_back(TokenType::MultiLineComment, comment_begin - buffer.data(), buffer.data() + buffer.size() - comment_begin);
+
+  return result;
+}
+
+/*!
+ * \fn void run(const std::vector<size_t>& sizes, const std::function<void(Tokenizer&, size_t)>& task)
+ * \param the size of each job
+ * \param the function processing a job
+ * \brief runs jobs on the thread pool
+ *
+ * \a task is called once for each index in \a sizes with the Tokenizer of
+ * the thread running the job; sizes are only used for scheduling.
+ * The call returns when all jobs are done.
+ * If some jobs throw, the exception of the first of them is rethrown.
+ */
+void BatchTokenizer::run(const std::vector<size_t>& sizes, const std::function<void(Tokenizer&, size_t)>& task)
+{
+  m_pool->run(sizes, task);
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
@@ -0,0 +1,175 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/compressedtokenbuffer.h"
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class CompressedTokenBuffer
+ */
+
+/*!
+ * \fn void setSource(string_view source)
+ * \param the new source string
+ * \brief changes the source string of the buffer
+ *
+ * Offsets are not modified, this is typically used when the source string
+ * has been moved to a different address.
+ */
+void CompressedTokenBuffer::setSource(string_view source)
+{
+  m_source = source;
+}
+
+/*!
+ * \fn void reserve(size_t n)
+ * \brief reserves memory for n tokens
+ *
+ * The memory reserved for the encoded offsets and lengths assumes that
+ * they take 1 byte each, which is the common case.
+ */
+void CompressedTokenBuffer::reserve(size_t n)
+{
+  m_types.reserve(n);
+  m_data.reserve(2 * n);
+  m_blocks.reserve((n + BlockSize - 1) / BlockSize);
+}
+
+/*!
+ * \fn void clear()
+ * \brief removes all tokens from the buffer
+ *
+ * The source string is left unchanged.
+ */
+void CompressedTokenBuffer::clear()
+{
+  m_types.clear();
+  m_data.clear();
+  m_blocks.clear();
+  m_end = 0;
+}
+
+/*!
+ * \fn void shrink_to_fit()
+ * \brief releases unused memory
+ */
+void CompressedTokenBuffer::shrink_to_fit()
+{
+  m_types.shrink_to_fit();
+  m_data.shrink_to_fit();
+  m_blocks.shrink_to_fit();
+}
+
+/*!
+ * \fn void append(const std::vector<Token>& tokens)
+ * \brief appends tokens to the buffer
+ *
+ * The text of all the tokens must be part of the source string of the buffer.
+ */
+void CompressedTokenBuffer::append(const std::vector<Token>& tokens)
+{
+  for (const Token& tok : tokens)
+    push_back(tok);
+}
+
+/*!
+ * \fn void append(const TokenBuffer& tokens)
+ * \brief appends the tokens of a TokenBuffer to the buffer
+ *
+ * The tokens must have the same source string as the buffer.
+ */
+void CompressedTokenBuffer::append(const TokenBuffer& tokens)
+{
+  for (size_t i(0); i < tokens.size(); ++i)
+    push_back(tokens.type(i), tokens.offset(i), tokens.length(i));
+}
+
+/*!
+ * \fn size_t offset(size_t i) const
+ * \brief returns the offset of the i-th token in the source
+ */
+size_t CompressedTokenBuffer::offset(size_t i) const
+{
+  size_t offset, length;
+  decode(i, offset, length);
+  return offset;
+}
+
+/*!
+ * \fn size_t length(size_t i) const
+ * \brief returns the length of the i-th token
+ */
+size_t CompressedTokenBuffer::length(size_t i) const
+{
+  size_t offset, length;
+  decode(i, offset, length);
+  return length;
+}
+
+/*!
+ * \fn string_view text(size_t i) const
+ * \brief returns the text of the i-th token
+ */
+string_view CompressedTokenBuffer::text(size_t i) const
+{
+  size_t offset, length;
+  decode(i, offset, length);
+  return string_view(m_source.data() + offset, length);
+}
+
+/*!
+ * \fn Token at(size_t i) const
+ * \brief returns the i-th token
+ *
+ * Throws std::out_of_range if \c i is not a valid index.
+ */
+Token CompressedTokenBuffer::at(size_t i) const
+{
+  if (i >= size())
+    throw std::out_of_range("CompressedTokenBuffer::at()");
+
+  return (*this)[i];
+}
+
+/*!
+ * \fn size_t memoryUsage() const
+ * \brief returns the number of bytes allocated by the buffer
+ */
+size_t CompressedTokenBuffer::memoryUsage() const
+{
+  return m_types.capacity() * sizeof(unsigned char)
+    + m_data.capacity() * sizeof(unsigned char)
+    + m_blocks.capacity() * sizeof(Block);
+}
+
+void CompressedTokenBuffer::decode(size_t i, size_t& offset, size_t& length) const
+{
+  const Block& b = m_blocks[i / BlockSize];
+  const unsigned char* p = m_data.data() + b.data;
+
+  offset = b.offset;
+  length = 0;
+
+  for (size_t k(0); k <= i % BlockSize; ++k)
+  {
+    offset += length + readVarint(p);
+    length = readVarint(p);
+  }
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
@@ -0,0 +1,355 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/dependencygraph.h"
+
+#include "cpptok/batchtokenizer.h"
+#include "cpptok/includescanner.h"
+#include "cpptok/json.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+static bool has_extension(const std::string& path, const char* const* first, const char* const* last)
+{
+  const std::string ext = fs::path(path).extension().string();
+  return std::find(first, last, ext) != last;
+}
+
+/*!
+ * \fn static bool isSourceFile(const std::string& path)
+ * \brief returns whether a path has the extension of a C or C++ source or header file
+ */
+bool DependencyGraph::isSourceFile(const std::string& path)
+{
+  static const char* const extensions[] = {
+    ".h", ".hh", ".hpp", ".hxx", ".c", ".cc", ".cpp", ".cxx", ".inl", ".ipp",
+  };
+
+  return has_extension(path, std::begin(extensions), std::end(extensions));
+}
+
+/*!
+ * \fn static bool isTranslationUnit(const std::string& path)
+ * \brief returns whether a path has the extension of a C or C++ source file
+ */
+bool DependencyGraph::isTranslationUnit(const std::string& path)
+{
+  static const char* const extensions[] = {
+    ".c", ".cc", ".cpp", ".cxx",
+  };
+
+  return has_extension(path, std::begin(extensions), std::end(extensions));
+}
+
+static std::string normalized(const fs::path& p)
+{
+  return p.lexically_normal().generic_string();
+}
+
+/*!
+ * \class DependencyGraph
+ */
+
+/*!
+ * \fn void addSearchPath(const std::string& dir)
+ * \brief adds a directory in which included files are searched
+ *
+ * Directories are searched in the order in which they were added.
+ */
+void DependencyGraph::addSearchPath(const std::string& dir)
+{
+  m_search_paths.push_back(dir);
+}
+
+/*!
+ * \fn void addRoot(const std::string& path)
+ * \brief adds a file whose dependencies are computed by the next scan()
+ */
+void DependencyGraph::addRoot(const std::string& path)
+{
+  addFile(normalized(path), true);
+}
+
+/*!
+ * \fn size_t indexOf(const std::string& path) const
+ * \brief returns the index of a file in the graph, or NoFile
+ */
+size_t DependencyGraph::indexOf(const std::string& path) const
+{
+  auto it = m_index.find(normalized(path));
+  return it != m_index.end() ? it->second : NoFile;
+}
+
+size_t DependencyGraph::addFile(const std::string& path, bool root)
+{
+  auto it = m_index.find(path);
+
+  if (it != m_index.end())
+  {
+    m_files[it->second].root |= root;
+    return it->second;
+  }
+
+  std::error_code ec;
+  const auto size = fs::file_size(path, ec);
+
+  File f;
+  f.path = path;
+  f.root = root;
+  f.size = ec ? 0 : static_cast<size_t>(size);
+
+  m_index[path] = m_files.size();
+  m_files.push_back(std::move(f));
+  return m_files.size() - 1;
+}
+
+// quoted includes are first searched relative to the including file
+std::string DependencyGraph::resolve(const File& includer, const Include& inc) const
+{
+  std::error_code ec;
+
+  if (!inc.angled)
+  {
+    const fs::path p = fs::path(includer.path).parent_path() / inc.name;
+
+    if (fs::is_regular_file(p, ec))
+      return normalized(p);
+  }
+
+  for (const std::string& dir : m_search_paths)
+  {
+    const fs::path p = fs::path(dir) / inc.name;
+
+    if (fs::is_regular_file(p, ec))
+      return normalized(p);
+  }
+
+  return {};
+}
+
+/*!
+ * \fn void scan(BatchTokenizer& batch)
+ * \brief scans the files that have not been scanned yet
+ *
+ * The files are scanned in parallel, and then the files they include,
+ * until the graph is complete.
+ * Resolving includes is done by the worker threads; only the insertion
+ * of the new files in the graph is sequential.
+ * Files that cannot be read are given an error message, and counted as
+ * failed in the statistics; scanning continues with the other files.
+ */
+void DependencyGraph::scan(BatchTokenizer& batch)
+{
+  while (m_scanned < m_files.size())
+  {
+    const size_t first = m_scanned;
+    const size_t count = m_files.size() - first;
+
+    std::vector<size_t> sizes;
+    sizes.reserve(count);
+
+    for (size_t i(first); i < m_files.size(); ++i)
+      sizes.push_back(m_files[i].size);
+
+    std::vector<std::vector<std::string>> resolved(count);
+
+    batch.run(sizes, [&](Tokenizer&, size_t i) {
+      File& f = m_files[first + i];
+      SourceFile source;
+
+      // a file that cannot be read (e.g. removed since it was found) does
+      // not prevent the other files from being scanned
+      try
+      {
+        source = SourceFile(f.path);
+      }
+      catch (const std::runtime_error& ex)
+      {
+        f.error = ex.what();
+        return;
+      }
+
+      for (const IncludeDirective& directive : scanIncludes(source.text()))
+      {
+        Include inc;
+        inc.name = std::string(directive.path);
+        inc.angled = directive.angled;
+        resolved[i].push_back(resolve(f, inc));
+        f.includes.push_back(std::move(inc));
+      }
+      });
+
+    for (size_t i(0); i < count; ++i)
+    {
+      if (!m_files[first + i].error.empty())
+      {
+        ++m_stats.failed;
+        continue;
+      }
+
+      m_stats.bytes += m_files[first + i].size;
+      m_stats.includes += resolved[i].size();
+
+      for (size_t j(0); j < resolved[i].size(); ++j)
+      {
+        if (resolved[i][j].empty())
+          ++m_stats.unresolved;
+        else
+          m_files[first + i].includes[j].file = addFile(resolved[i][j], false);
+      }
+    }
+
+    m_scanned = first + count;
+    ++m_stats.passes;
+  }
+}
+
+/*!
+ * \fn std::vector<size_t> dependencies(size_t file) const
+ * \brief returns the files included, directly or not, by a file
+ *
+ * The files are listed in the order in which a depth-first traversal finds
+ * them; a file that (indirectly) includes itself is not listed.
+ */
+std::vector<size_t> DependencyGraph::dependencies(size_t file) const
+{
+  std::vector<size_t> result;
+  std::vector<bool> visited(m_files.size(), false);
+  std::vector<size_t> stack{ file };
+  visited[file] = true;
+
+  while (!stack.empty())
+  {
+    const size_t f = stack.back();
+    stack.pop_back();
+
+    if (f != file)
+      result.push_back(f);
+
+    const std::vector<Include>& includes = m_files[f].includes;
+
+    for (auto it = includes.rbegin(); it != includes.rend(); ++it)
+    {
+      if (it->file != NoFile && !visited[it->file])
+      {
+        visited[it->file] = true;
+        stack.push_back(it->file);
+      }
+    }
+  }
+
+  return result;
+}
+
+static std::string make_escape(const std::string& path)
+{
+  std::string result;
+
+  for (char c : path)
+  {
+    if (c == ' ' || c == '#')
+      result += '\\';
+    else if (c == '$')
+      result += '$';
+
+    result += c;
+  }
+
+  return result;
+}
+
+/*!
+ * \fn void writeMakefile(std::ostream& out) const
+ * \brief writes the dependencies of the root translation units as Makefile rules
+ *
+ * There is one rule per translation unit, in the format of the compiler's
+ * -M option: the object file depends on the source file and on all the
+ * headers it includes, directly or not.
+ */
+void DependencyGraph::writeMakefile(std::ostream& out) const
+{
+  for (size_t i(0); i < m_files.size(); ++i)
+  {
+    const File& f = m_files[i];
+
+    if (!f.root || !isTranslationUnit(f.path))
+      continue;
+
+    out << make_escape(fs::path(f.path).replace_extension(".o").generic_string()) << ": " << make_escape(f.path);
+
+    for (size_t dep : dependencies(i))
+      out << " \\\n  " << make_escape(m_files[dep].path);
+
+    out << "\n";
+  }
+}
+
+/*!
+ * \fn void writeJson(std::ostream& out) const
+ * \brief writes the direct includes of every file of the graph as JSON
+ *
+ * Includes that could not be resolved have a null "file"; files that could
+ * not be read have an "error".
+ */
+void DependencyGraph::writeJson(std::ostream& out) const
+{
+  out << "{\n  \"files\": [";
+
+  for (size_t i(0); i < m_files.size(); ++i)
+  {
+    const File& f = m_files[i];
+
+    out << (i == 0 ? "\n" : ",\n");
+    out << "    { \"path\": \"" << jsonEscape(f.path) << "\", \"root\": " << (f.root ? "true" : "false")
+      << ", \"includes\": [";
+
+    for (size_t j(0); j < f.includes.size(); ++j)
+    {
+      const Include& inc = f.includes[j];
+
+      out << (j == 0 ? "" : ", ");
+      out << "{ \"name\": \"" << jsonEscape(inc.name) << "\", \"angled\": " << (inc.angled ? "true" : "false")
+        << ", \"file\": ";
+
+      if (inc.file != NoFile)
+        out << inc.file;
+      else
+        out << "null";
+
+      out << " }";
+    }
+
+    out << "]";
+
+    if (!f.error.empty())
+      out << ", \"error\": \"" << jsonEscape(f.error) << "\"";
+
+    out << " }";
+  }
+
+  out << "\n  ]\n}\n";
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
@@ -0,0 +1,203 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/documenttokenizer.h"
+
+#include <stdexcept>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+static std::vector<std::string> split_lines(string_view text)
+{
+  std::vector<std::string> lines;
+
+  for (;;)
+  {
+    const size_t lf = text.find('\n');
+
+    if (lf == string_view::npos)
+    {
+      lines.emplace_back(text);
+      return lines;
+    }
+
+    lines.emplace_back(text.substr(0, lf));
+    text.remove_prefix(lf + 1);
+  }
+}
+
+/*!
+ * \class DocumentTokenizer
+ */
+
+/*!
+ * \fn DocumentTokenizer()
+ * \brief constructs a document made of a single empty line
+ */
+DocumentTokenizer::DocumentTokenizer()
+{
+  setText(string_view());
+}
+
+/*!
+ * \fn DocumentTokenizer(string_view text)
+ * \param the initial text of the document
+ * \brief constructs and tokenizes a document
+ */
+DocumentTokenizer::DocumentTokenizer(string_view text)
+{
+  setText(text);
+}
+
+DocumentTokenizer::~DocumentTokenizer() = default;
+
+/*!
+ * \fn void setText(string_view text)
+ * \param the new text of the document
+ * \brief replaces the whole document
+ */
+void DocumentTokenizer::setText(string_view text)
+{
+  m_lines.clear();
+
+  for (std::string& str : split_lines(text))
+  {
+    m_lines.push_back(std::make_unique<Line>());
+    m_lines.back()->text = std::move(str);
+  }
+
+  relex(0, m_lines.size());
+}
+
+/*!
+ * \fn std::string text() const
+ * \brief returns the text of the document
+ */
+std::string DocumentTokenizer::text() const
+{
+  std::string result;
+
+  for (size_t i(0); i < m_lines.size(); ++i)
+  {
+    if (i > 0)
+      result.push_back('\n');
+
+    result += m_lines[i]->text;
+  }
+
+  return result;
+}
+
+/*!
+ * \fn size_t replace(size_t first_line, size_t first_column, size_t last_line, size_t last_column, string_view text)
+ * \param the line of the first replaced character
+ * \param the column of the first replaced character
+ * \param the line of the end of the replaced range
+ * \param the column past the last replaced character
+ * \param the new text, which may contain newlines
+ * \brief replaces a range of text and updates the tokens
+ *
+ * Returns the number of lines that were relexed.
+ * Throws std::out_of_range if the range is not valid.
+ */
+size_t DocumentTokenizer::replace(size_t first_line, size_t first_column, size_t last_line, size_t last_column, string_view text)
+{
+  if (last_line < first_line || last_line >= m_lines.size()
+    || first_column > m_lines[first_line]->text.size() || last_column > m_lines[last_line]->text.size()
+    || (first_line == last_line && last_column < first_column))
+    throw std::out_of_range("DocumentTokenizer::replace()");
+
+  std::string content = m_lines[first_line]->text.substr(0, first_column);
+  content.append(text.data(), text.size());
+  content += string_view(m_lines[last_line]->text).substr(last_column);
+
+  std::vector<std::string> new_lines = split_lines(content);
+
+  // reuses the existing lines as much as possible
+  const size_t old_count = last_line - first_line + 1;
+  const size_t common = std::min(old_count, new_lines.size());
+
+  for (size_t i(0); i < common; ++i)
+    m_lines[first_line + i]->text = std::move(new_lines[i]);
+
+  if (new_lines.size() < old_count)
+  {
+    m_lines.erase(m_lines.begin() + first_line + common, m_lines.begin() + first_line + old_count);
+  }
+  else if (new_lines.size() > old_count)
+  {
+    std::vector<std::unique_ptr<Line>> inserted;
+
+    for (size_t i(common); i < new_lines.size(); ++i)
+    {
+      inserted.push_back(std::make_unique<Line>());
+      inserted.back()->text = std::move(new_lines[i]);
+    }
+
+    m_lines.insert(m_lines.begin() + first_line + common,
+      std::make_move_iterator(inserted.begin()), std::make_move_iterator(inserted.end()));
+  }
+
+  return relex(first_line, new_lines.size());
+}
+
+/*!
+ * \fn size_t insert(size_t line, size_t column, string_view text)
+ * \param the line where the text is inserted
+ * \param the column where the text is inserted
+ * \param the text to insert, which may contain newlines
+ * \brief inserts text and updates the tokens
+ *
+ * Returns the number of lines that were relexed.
+ */
+size_t DocumentTokenizer::insert(size_t line, size_t column, string_view text)
+{
+  return replace(line, column, line, column, text);
+}
+
+/*
+ * Relexes the lines [first, first + count) and then the following lines
+ * until the state at the start of a line is the one recorded previously.
+ */
+size_t DocumentTokenizer::relex(size_t first, size_t count)
+{
+  Tokenizer::State state = first > 0 ? m_lines[first - 1]->end_state : Tokenizer::Default;
+  size_t i = first;
+
+  for (; i < m_lines.size(); ++i)
+  {
+    Line& line = *m_lines[i];
+
+    if (i >= first + count && line.start_state == state)
+      break;
+
+    m_lexer.state = state;
+    m_lexer.output.clear();
+    m_lexer.tokenize(line.text);
+
+    // the vectors are swapped so that their capacity is reused
+    std::swap(line.tokens, m_lexer.output);
+    line.start_state = state;
+    line.end_state = m_lexer.state;
+
+    state = line.end_state;
+  }
+
+  return i - first;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
@@ -0,0 +1,164 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/identifiertable.h"
+
+#include "cpptok/basictokenizer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class IdentifierTable
+ */
+
+/*!
+ * \fn IdentifierTable()
+ * \brief constructs a table containing the keywords
+ */
+IdentifierTable::IdentifierTable()
+{
+  rebuild(std::size(details::keywords), size_t(-1));
+
+  for (const details::Keyword& k : details::keywords)
+    add(k.name, k.toktype);
+}
+
+/*!
+ * \fn void add(string_view name, TokenType type)
+ * \param the identifier
+ * \param its token type
+ * \brief adds a name to the table, or changes its type
+ *
+ * Throws std::invalid_argument if the name is empty.
+ */
+void IdentifierTable::add(string_view name, TokenType type)
+{
+  if (name.empty())
+    throw std::invalid_argument("IdentifierTable::add()");
+
+  size_t i = slotIndex(name.data(), name.size());
+
+  if (m_slots[i].length != 0)
+  {
+    m_slots[i].type = type.value();
+    return;
+  }
+
+  // keeps the table at most a quarter full
+  if (4 * (m_size + 1) > m_slots.size())
+  {
+    rebuild(m_size + 1, size_t(-1));
+    i = slotIndex(name.data(), name.size());
+  }
+
+  insert(i, name.data(), name.size(), type.value());
+}
+
+/*!
+ * \fn void remove(string_view name)
+ * \brief removes a name from the table
+ *
+ * The name is then a UserDefinedName, even if it is a keyword.
+ */
+void IdentifierTable::remove(string_view name)
+{
+  if (name.empty() || name.size() > m_max_length)
+    return;
+
+  const size_t i = slotIndex(name.data(), name.size());
+
+  if (m_slots[i].length != 0)
+    rebuild(m_size - 1, i);
+}
+
+/*!
+ * \fn void clear()
+ * \brief removes all names, including the keywords, from the table
+ */
+void IdentifierTable::clear()
+{
+  m_size = 0;
+  m_names.clear();
+  m_max_length = 0;
+  m_slots.assign(m_slots.size(), Slot());
+}
+
+/*!
+ * \fn size_t size() const
+ * \brief returns the number of names in the table
+ */
+size_t IdentifierTable::size() const
+{
+  return m_size;
+}
+
+// returns the slot containing the name, or the empty slot where it would be inserted
+size_t IdentifierTable::slotIndex(const char* str, size_t len) const
+{
+  const size_t mask = m_slots.size() - 1;
+  size_t i = hash(str, len) >> m_shift;
+
+  while (m_slots[i].length != 0 && (m_slots[i].length != len || std::memcmp(m_names.data() + m_slots[i].offset, str, len) != 0))
+    i = (i + 1) & mask;
+
+  return i;
+}
+
+void IdentifierTable::insert(size_t slot, const char* str, size_t len, TokenType::Value type)
+{
+  m_slots[slot].offset = static_cast<uint32_t>(m_names.size());
+  m_slots[slot].length = static_cast<uint32_t>(len);
+  m_slots[slot].type = type;
+
+  m_names.append(str, len);
+  m_max_length = std::max(m_max_length, len);
+  ++m_size;
+}
+
+// reinserts all the names (but the one in removed_slot) in a table
+// that can hold at least capacity names
+void IdentifierTable::rebuild(size_t capacity, size_t removed_slot)
+{
+  unsigned int bits = 8;
+
+  while ((size_t(1) << bits) < 4 * capacity)
+    ++bits;
+
+  std::vector<Slot> slots = std::move(m_slots);
+  std::string names = std::move(m_names);
+
+  m_slots.assign(size_t(1) << bits, Slot());
+  m_shift = 32 - bits;
+  m_names.clear();
+  m_size = 0;
+  m_max_length = 0;
+
+  for (size_t i(0); i < slots.size(); ++i)
+  {
+    if (slots[i].length == 0 || i == removed_slot)
+      continue;
+
+    const char* str = names.data() + slots[i].offset;
+    insert(slotIndex(str, slots[i].length), str, slots[i].length, slots[i].type);
+  }
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
@@ -0,0 +1,283 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/includescanner.h"
+
+#include "cpptok/scan.h"
+
+#include <cstring>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+static bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static bool is_identifier_char(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) || c == '_';
+}
+
+static const char* skip_horizontal_spaces(const char* p, const char* end)
+{
+  while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\f' || *p == '\v'))
+    ++p;
+
+  return p;
+}
+
+// returns whether the newline at p is escaped by a backslash
+static bool is_continued(const char* begin, const char* p)
+{
+  if (p != begin && p[-1] == '\r')
+    --p;
+
+  return p != begin && p[-1] == '\\';
+}
+
+// returns the first character of the identifier that ends at p
+static const char* identifier_start(const char* begin, const char* p)
+{
+  while (p != begin && is_identifier_char(p[-1]))
+    --p;
+
+  return p;
+}
+
+// returns the first character of the pp-number (or identifier) that ends at p
+static const char* number_start(const char* begin, const char* p)
+{
+  while (p != begin && (is_identifier_char(p[-1]) || p[-1] == '\''))
+    --p;
+
+  return p;
+}
+
+// skips a comment starting with "/*" at p
+static const char* skip_long_comment(const char* p, const char* end)
+{
+  p = scan::findPair(p + 2, end, '*', '/');
+  return p == end ? end : p + 2;
+}
+
+// skips a comment starting with "//" at p, up to (but excluding) the newline
+static const char* skip_line_comment(const char* begin, const char* p, const char* end)
+{
+  for (;;)
+  {
+    p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+
+    if (!p)
+      return end;
+
+    if (!is_continued(begin, p))
+      return p;
+
+    ++p;
+  }
+}
+
+// skips a string or char literal whose opening quote is at p;
+// an unterminated literal stops at the end of the line
+static const char* skip_quoted(const char* p, const char* end)
+{
+  const char quote = *p++;
+
+  for (;;)
+  {
+    p = scan::findFirstOf(p, end, quote, '\\', '\n');
+
+    if (p == end || *p == '\n')
+      return p;
+    else if (*p == quote)
+      return p + 1;
+
+    p = (end - p) > 1 ? p + 2 : end;
+  }
+}
+
+// returns whether the quote at p opens a raw string literal (R"delim(...)delim")
+static bool is_raw_string(const char* begin, const char* p)
+{
+  if (p == begin || p[-1] != 'R')
+    return false;
+
+  const char* prefix = identifier_start(begin, p - 1);
+  const string_view encoding{ prefix, size_t(p - 1 - prefix) };
+  return encoding.empty() || encoding == "u8" || encoding == "u" || encoding == "U" || encoding == "L";
+}
+
+static const char* skip_raw_string(const char* p, const char* end)
+{
+  const char* delim = ++p;
+
+  while (p != end && *p != '(' && *p != '\n')
+    ++p;
+
+  if (p == end || *p == '\n' || p - delim > 16)
+    return p;
+
+  const size_t delim_length = p - delim;
+
+  for (;;)
+  {
+    p = static_cast<const char*>(std::memchr(p, ')', end - p));
+
+    if (!p)
+      return end;
+
+    ++p;
+
+    if (size_t(end - p) > delim_length && std::memcmp(p, delim, delim_length) == 0 && p[delim_length] == '"')
+      return p + delim_length + 1;
+  }
+}
+
+// skips the rest of the line starting at p, including any comment or literal
+// spanning several lines, and returns the start of the next line
+static const char* skip_line(const char* begin, const char* p, const char* end)
+{
+  for (;;)
+  {
+    p = scan::findFirstOf(p, end, '\n', '/', '"', '\'');
+
+    if (p == end)
+      return end;
+
+    switch (*p)
+    {
+    case '\n':
+      if (!is_continued(begin, p))
+        return p + 1;
+      ++p;
+      break;
+    case '/':
+      if (end - p > 1 && p[1] == '/')
+        p = skip_line_comment(begin, p, end);
+      else if (end - p > 1 && p[1] == '*')
+        p = skip_long_comment(p, end);
+      else
+        ++p;
+      break;
+    case '"':
+      p = is_raw_string(begin, p) ? skip_raw_string(p, end) : skip_quoted(p, end);
+      break;
+    default:
+      // a quote inside a number is a digit separator (e.g. 1'000'000)
+      if (p != begin && is_identifier_char(p[-1]) && is_digit(*number_start(begin, p)))
+        ++p;
+      else
+        p = skip_quoted(p, end);
+      break;
+    }
+  }
+}
+
+// skips whitespace and comments at the beginning of a line
+static const char* skip_leading_blanks(const char* p, const char* end)
+{
+  for (;;)
+  {
+    p = skip_horizontal_spaces(p, end);
+
+    if (end - p > 1 && p[0] == '/' && p[1] == '*')
+      p = skip_long_comment(p, end);
+    else
+      return p;
+  }
+}
+
+// reads the directive whose '#' is at p and returns a pointer past
+// what has been read
+static const char* read_directive(const char* begin, const char* p, const char* end, std::vector<IncludeDirective>& result)
+{
+  const char* hash = p;
+  p = skip_leading_blanks(p + 1, end);
+
+  const char* name = p;
+  p = scan::skipIdentifier(p, end);
+
+  if (string_view(name, p - name) != "include")
+    return p;
+
+  p = skip_leading_blanks(p, end);
+
+  if (p == end || (*p != '<' && *p != '"'))
+    return p;
+
+  const bool angled = *p == '<';
+  const char* path = p + 1;
+  p = scan::findFirstOf(path, end, angled ? '>' : '"', '\n', '\n');
+
+  if (p == end || *p == '\n')
+    return p;
+
+  IncludeDirective directive;
+  directive.path = string_view(path, p - path);
+  directive.angled = angled;
+  directive.offset = hash - begin;
+  result.push_back(directive);
+
+  return p + 1;
+}
+
+/*!
+ * \fn void scanIncludes(string_view source, std::vector<IncludeDirective>& result)
+ * \param the source code
+ * \param vector to which the include directives are appended
+ * \brief finds the include directives of a source file without tokenizing it
+ *
+ * Only lines whose first token is a '#' are examined; the rest of the source
+ * is crossed with scan::findFirstOf() looking for newlines and for the start
+ * of comments and literals, which may hide newlines or a '#'.
+ * Include directives that appear inside conditional blocks (e.g. #if 0)
+ * are reported as well.
+ * A leading UTF-8 byte order mark is ignored.
+ *
+ * The paths refer to the source string, which must outlive them.
+ */
+void scanIncludes(string_view source, std::vector<IncludeDirective>& result)
+{
+  const char* begin = source.data();
+  const char* end = begin + source.size();
+  const char* p = begin;
+
+  // a UTF-8 byte order mark is not part of the first line
+  if (source.size() >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0)
+    p += 3;
+
+  while (p != end)
+  {
+    p = skip_leading_blanks(p, end);
+
+    if (p != end && *p == '#')
+      p = read_directive(begin, p, end, result);
+
+    p = skip_line(begin, p, end);
+  }
+}
+
+/*!
+ * \fn std::vector<IncludeDirective> scanIncludes(string_view source)
+ * \param the source code
+ * \brief returns the include directives of a source file
+ */
+std::vector<IncludeDirective> scanIncludes(string_view source)
+{
+  std::vector<IncludeDirective> result;
+  scanIncludes(source, result);
+  return result;
+}
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
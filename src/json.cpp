@@ -0,0 +1,57 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/json.h"
+
+#include <cstdio>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \fn std::string jsonEscape(string_view str)
+ * \param a string
+ * \brief returns the string with the characters that cannot appear in a JSON string escaped
+ *
+ * The quotes surrounding the string are not added.
+ */
+std::string jsonEscape(string_view str)
+{
+  std::string result;
+  result.reserve(str.size());
+
+  for (char c : str)
+  {
+    switch (c)
+    {
+    case '"': result += "\\\""; break;
+    case '\\': result += "\\\\"; break;
+    case '\n': result += "\\n"; break;
+    case '\t': result += "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+      {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+        result += buffer;
+      }
+      else
+      {
+        result += c;
+      }
+    }
+  }
+
+  return result;
+}
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
@@ -0,0 +1,69 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/lineindex.h"
+
+#include "cpptok/scan.h"
+
+#include <algorithm>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class LineIndex
+ */
+
+/*!
+ * \fn void build(const char* str, size_t len)
+ * \param the text to index
+ * \param the length of the text
+ * \brief computes the line index of a text
+ *
+ * Any previous content of the index is discarded.
+ */
+void LineIndex::build(const char* str, size_t len)
+{
+  m_line_starts.clear();
+  m_line_starts.push_back(0);
+
+  scan::findAll(str, str + len, '\n', m_line_starts);
+
+  // lines start right after the newline characters
+  for (size_t i(1); i < m_line_starts.size(); ++i)
+    m_line_starts[i] += 1;
+}
+
+/*!
+ * \fn void clear()
+ * \brief resets the index to a single empty line
+ */
+void LineIndex::clear()
+{
+  m_line_starts.assign(1, 0);
+}
+
+/*!
+ * \fn size_t lineOf(size_t offset) const
+ * \brief returns the line containing the character at the given offset
+ */
+size_t LineIndex::lineOf(size_t offset) const
+{
+  auto it = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset);
+  return std::distance(m_line_starts.begin(), it) - 1;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
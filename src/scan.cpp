@@ -0,0 +1,555 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/scan.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && defined(__SSE2__))
+#  define CPPTOK_SCAN_X86
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define CPPTOK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#  define CPPTOK_TARGET_AVX2
+#endif
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \namespace scan
+ */
+
+namespace scan
+{
+
+static inline bool is_whitespace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool is_identifier_char(char c)
+{
+  return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_';
+}
+
+namespace scalar
+{
+
+static const char* skip_whitespace(const char* begin, const char* end)
+{
+  while (begin != end && is_whitespace(*begin))
+    ++begin;
+
+  return begin;
+}
+
+static const char* skip_identifier(const char* begin, const char* end)
+{
+  while (begin != end && is_identifier_char(*begin))
+    ++begin;
+
+  return begin;
+}
+
+static const char* find_first_of(const char* begin, const char* end, char a, char b, char c, char d)
+{
+  while (begin != end && *begin != a && *begin != b && *begin != c && *begin != d)
+    ++begin;
+
+  return begin;
+}
+
+static const char* find_pair(const char* begin, const char* end, char a, char b)
+{
+  if (begin == end)
+    return end;
+
+  for (const char* last = end - 1; begin != last; ++begin)
+  {
+    if (begin[0] == a && begin[1] == b)
+      return begin;
+  }
+
+  return end;
+}
+
+static void find_all(const char* begin, const char* it, const char* end, char c, std::vector<size_t>& positions)
+{
+  while (it != end)
+  {
+    const void* found = std::memchr(it, c, end - it);
+
+    if (!found)
+      return;
+
+    it = static_cast<const char*>(found);
+    positions.push_back(it - begin);
+    ++it;
+  }
+}
+
+} // namespace scalar
+
+#if defined(CPPTOK_SCAN_X86)
+
+static inline unsigned count_trailing_zeros(unsigned mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+namespace sse2
+{
+
+static inline __m128i whitespace_mask(__m128i v)
+{
+  const __m128i spaces = _mm_or_si128(
+    _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+    _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+
+  const __m128i newlines = _mm_or_si128(
+    _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+    _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+
+  return _mm_or_si128(spaces, newlines);
+}
+
+static const char* skip_whitespace(const char* begin, const char* end)
+{
+  while (end - begin >= 16)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(whitespace_mask(v))) & 0xFFFF;
+
+    if (mask != 0)
+      return begin + count_trailing_zeros(mask);
+
+    begin += 16;
+  }
+
+  return scalar::skip_whitespace(begin, end);
+}
+
+/*
+ * Characters are compared as signed bytes: bytes above 0x7F are negative
+ * and therefore never fall in the ASCII ranges we test.
+ * Setting the 0x20 bit maps upper-case letters onto lower-case letters 
+ * without creating other letters.
+ */
+static inline __m128i identifier_mask(__m128i v)
+{
+  const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  const __m128i letters = _mm_and_si128(
+    _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+    _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+
+  const __m128i digits = _mm_and_si128(
+    _mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+    _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+
+  const __m128i underscores = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+
+  return _mm_or_si128(letters, _mm_or_si128(digits, underscores));
+}
+
+static const char* skip_identifier(const char* begin, const char* end)
+{
+  while (end - begin >= 16)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(identifier_mask(v))) & 0xFFFF;
+
+    if (mask != 0)
+      return begin + count_trailing_zeros(mask);
+
+    begin += 16;
+  }
+
+  return scalar::skip_identifier(begin, end);
+}
+
+static const char* find_first_of(const char* begin, const char* end, char a, char b, char c, char d)
+{
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  const __m128i vc = _mm_set1_epi8(c);
+  const __m128i vd = _mm_set1_epi8(d);
+
+  while (end - begin >= 16)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+      _mm_or_si128(_mm_cmpeq_epi8(v, vc), _mm_cmpeq_epi8(v, vd)));
+    const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq));
+
+    if (mask != 0)
+      return begin + count_trailing_zeros(mask);
+
+    begin += 16;
+  }
+
+  return scalar::find_first_of(begin, end, a, b, c, d);
+}
+
+static const char* find_pair(const char* begin, const char* end, char a, char b)
+{
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+
+  while (end - begin >= 17)
+  {
+    const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + 1));
+    const __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(first, va), _mm_cmpeq_epi8(second, vb));
+    const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq));
+
+    if (mask != 0)
+      return begin + count_trailing_zeros(mask);
+
+    begin += 16;
+  }
+
+  return scalar::find_pair(begin, end, a, b);
+}
+
+static void find_all(const char* begin, const char* it, const char* end, char c, std::vector<size_t>& positions)
+{
+  const __m128i vc = _mm_set1_epi8(c);
+
+  while (end - it >= 16)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)));
+
+    while (mask != 0)
+    {
+      positions.push_back((it - begin) + count_trailing_zeros(mask));
+      mask &= mask - 1;
+    }
+
+    it += 16;
+  }
+
+  scalar::find_all(begin, it, end, c, positions);
+}
+
+} // namespace sse2
+
+namespace avx2
+{
+
+CPPTOK_TARGET_AVX2 static inline __m256i whitespace_mask(__m256i v)
+{
+  const __m256i spaces = _mm256_or_si256(
+    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+
+  const __m256i newlines = _mm256_or_si256(
+    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+
+  return _mm256_or_si256(spaces, newlines);
+}
+
+CPPTOK_TARGET_AVX2 static const char* skip_whitespace(const char* begin, const char* end)
+{
+  while (end - begin >= 32)
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(whitespace_mask(v)));
+
+    if (mask != 0)
+      return begin + count_trailing_zeros(mask);
+
+    begin += 32;
+  }
+
+  return sse2::skip_whitespace(begin, end);
+}
+
+CPPTOK_TARGET_AVX2 static inline __m256i identifier_mask(__m256i v)
+{
+  const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+  const __m256i letters = _mm256_and_si256(
+    _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+    _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+
+  const __m256i digits = _mm256_and_si256(
+    _mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+    _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+
+  const __m256i underscores = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+
+  return _mm256_or_si256(letters, _mm256_or_si256(digits, underscores));
+}
+
+CPPTOK_TARGET_AVX2 static const char* skip_identifier(const char* begin, const char* end)
+{
+  while (end - begin >= 32)
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(identifier_mask(v)));
+
+    if (mask != 0)
+      return begin + count_trailing_zeros(mask);
+
+    begin += 32;
+  }
+
+  return sse2::skip_identifier(begin, end);
+}
+
+CPPTOK_TARGET_AVX2 static const char* find_first_of(const char* begin, const char* end, char a, char b, char c, char d)
+{
+  const __m256i va = _mm256_set1_epi8(a);
+  const __m256i vb = _mm256_set1_epi8(b);
+  const __m256i vc = _mm256_set1_epi8(c);
+  const __m256i vd = _mm256_set1_epi8(d);
+
+  while (end - begin >= 32)
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    const __m256i eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, vc), _mm256_cmpeq_epi8(v, vd)));
+    const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+
+    if (mask != 0)
+      return begin + count_trailing_zeros(mask);
+
+    begin += 32;
+  }
+
+  return sse2::find_first_of(begin, end, a, b, c, d);
+}
+
+CPPTOK_TARGET_AVX2 static const char* find_pair(const char* begin, const char* end, char a, char b)
+{
+  const __m256i va = _mm256_set1_epi8(a);
+  const __m256i vb = _mm256_set1_epi8(b);
+
+  while (end - begin >= 33)
+  {
+    const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + 1));
+    const __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, va), _mm256_cmpeq_epi8(second, vb));
+    const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+
+    if (mask != 0)
+      return begin + count_trailing_zeros(mask);
+
+    begin += 32;
+  }
+
+  return sse2::find_pair(begin, end, a, b);
+}
+
+CPPTOK_TARGET_AVX2 static void find_all(const char* begin, const char* it, const char* end, char c, std::vector<size_t>& positions)
+{
+  const __m256i vc = _mm256_set1_epi8(c);
+
+  while (end - it >= 32)
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc)));
+
+    while (mask != 0)
+    {
+      positions.push_back((it - begin) + count_trailing_zeros(mask));
+      mask &= mask - 1;
+    }
+
+    it += 32;
+  }
+
+  sse2::find_all(begin, it, end, c, positions);
+}
+
+} // namespace avx2
+
+static bool cpu_supports_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+
+  if (info[0] < 7)
+    return false;
+
+  __cpuid(info, 1);
+
+  const bool osxsave = info[2] & (1 << 27);
+  const bool avx = info[2] & (1 << 28);
+
+  if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return info[1] & (1 << 5);
+#else
+  // called from a static initializer, possibly before the one of libgcc
+  // that fills the CPU model
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // defined(CPPTOK_SCAN_X86)
+
+/*
+ * Runtime dispatch.
+ * The implementation is selected once, when the library is loaded.
+ * The CPPTOK_SCAN environment variable ("scalar", "sse2" or "avx2") can be
+ * used to force a less capable implementation, e.g. for benchmarking.
+ */
+
+struct Dispatch
+{
+  Implementation impl;
+  const char* (*skip_whitespace)(const char*, const char*);
+  const char* (*skip_identifier)(const char*, const char*);
+  const char* (*find_first_of)(const char*, const char*, char, char, char, char);
+  const char* (*find_pair)(const char*, const char*, char, char);
+  void (*find_all)(const char*, const char*, const char*, char, std::vector<size_t>&);
+};
+
+static Dispatch make_dispatch(Implementation impl)
+{
+  switch (impl)
+  {
+#if defined(CPPTOK_SCAN_X86)
+  case Implementation::AVX2:
+    return Dispatch{ impl, &avx2::skip_whitespace, &avx2::skip_identifier, &avx2::find_first_of, &avx2::find_pair, &avx2::find_all };
+  case Implementation::SSE2:
+    return Dispatch{ impl, &sse2::skip_whitespace, &sse2::skip_identifier, &sse2::find_first_of, &sse2::find_pair, &sse2::find_all };
+#endif
+  default:
+    return Dispatch{ Implementation::Scalar, &scalar::skip_whitespace, &scalar::skip_identifier, &scalar::find_first_of, &scalar::find_pair, &scalar::find_all };
+  }
+}
+
+static Dispatch select_dispatch()
+{
+  Implementation best = Implementation::Scalar;
+
+#if defined(CPPTOK_SCAN_X86)
+  best = cpu_supports_avx2() ? Implementation::AVX2 : Implementation::SSE2;
+#endif
+
+  if (const char* env = std::getenv("CPPTOK_SCAN"))
+  {
+    if (std::strcmp(env, "scalar") == 0)
+      best = Implementation::Scalar;
+    else if (std::strcmp(env, "sse2") == 0 && best == Implementation::AVX2)
+      best = Implementation::SSE2;
+  }
+
+  return make_dispatch(best);
+}
+
+static const Dispatch g_dispatch = select_dispatch();
+
+/*!
+ * \fn Implementation implementation()
+ * \brief returns the implementation that was selected for the current CPU
+ */
+Implementation implementation()
+{
+  return g_dispatch.impl;
+}
+
+/*!
+ * \fn const char* skipWhitespace(const char* begin, const char* end)
+ * \brief returns a pointer to the first character that is not a whitespace
+ *
+ * Spaces, tabulations, line feeds and carriage returns are considered
+ * whitespace (the characters that Tokenizer::isDiscardable() accepts).
+ * Returns \c end if the whole range is made of whitespace.
+ */
+const char* skipWhitespace(const char* begin, const char* end)
+{
+  return g_dispatch.skip_whitespace(begin, end);
+}
+
+/*!
+ * \fn const char* skipIdentifier(const char* begin, const char* end)
+ * \brief returns a pointer to the first character that cannot appear in an identifier
+ *
+ * Letters, digits and underscores are accepted.
+ * Returns \c end if the whole range is made of such characters.
+ */
+const char* skipIdentifier(const char* begin, const char* end)
+{
+  return g_dispatch.skip_identifier(begin, end);
+}
+
+/*!
+ * \fn const char* findFirstOf(const char* begin, const char* end, char a, char b, char c)
+ * \brief returns a pointer to the first occurrence of any of the given characters
+ *
+ * Returns \c end if none of the characters is found.
+ * The same character may be passed several times to search for fewer than three characters.
+ */
+const char* findFirstOf(const char* begin, const char* end, char a, char b, char c)
+{
+  return g_dispatch.find_first_of(begin, end, a, b, c, c);
+}
+
+/*!
+ * \fn const char* findFirstOf(const char* begin, const char* end, char a, char b, char c, char d)
+ * \brief returns a pointer to the first occurrence of any of the four given characters
+ */
+const char* findFirstOf(const char* begin, const char* end, char a, char b, char c, char d)
+{
+  return g_dispatch.find_first_of(begin, end, a, b, c, d);
+}
+
+/*!
+ * \fn const char* findPair(const char* begin, const char* end, char a, char b)
+ * \brief returns a pointer to the first occurrence of \c a immediately followed by \c b
+ *
+ * Returns \c end if the pair is not found.
+ */
+const char* findPair(const char* begin, const char* end, char a, char b)
+{
+  return g_dispatch.find_pair(begin, end, a, b);
+}
+
+/*!
+ * \fn void findAll(const char* begin, const char* end, char c, std::vector<size_t>& positions)
+ * \brief appends the positions (relative to \c begin) of all the occurrences of a character
+ */
+void findAll(const char* begin, const char* end, char c, std::vector<size_t>& positions)
+{
+  g_dispatch.find_all(begin, begin, end, c, positions);
+}
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace scan
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
@@ -0,0 +1,262 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/sourcefile.h"
+
+#include "cpptok/tokenizer.h"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*
+ * The mapping of a file.
+ * Empty files are not mapped at all, in which case data is null.
+ */
+class SourceFile::Mapping
+{
+public:
+  std::string path;
+  const char* data = nullptr;
+  size_t size = 0;
+
+  explicit Mapping(const std::string& p);
+  Mapping(const Mapping&) = delete;
+  ~Mapping();
+
+  Mapping& operator=(const Mapping&) = delete;
+};
+
+static std::runtime_error mapping_error(const char* what, const std::string& path)
+{
+  return std::runtime_error(std::string("SourceFile: ") + what + " '" + path + "'");
+}
+
+#if defined(_WIN32)
+
+SourceFile::Mapping::Mapping(const std::string& p)
+  : path(p)
+{
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+  if (file == INVALID_HANDLE_VALUE)
+    throw mapping_error("could not open", path);
+
+  LARGE_INTEGER file_size;
+
+  if (!GetFileSizeEx(file, &file_size))
+  {
+    CloseHandle(file);
+    throw mapping_error("could not read the size of", path);
+  }
+
+  size = static_cast<size_t>(file_size.QuadPart);
+
+  if (size > 0)
+  {
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping)
+    {
+      data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+      // the view keeps a reference to the mapping object
+      CloseHandle(mapping);
+    }
+
+    if (!data)
+    {
+      CloseHandle(file);
+      throw mapping_error("could not map", path);
+    }
+  }
+
+  CloseHandle(file);
+}
+
+SourceFile::Mapping::~Mapping()
+{
+  if (data)
+    UnmapViewOfFile(data);
+}
+
+#else
+
+SourceFile::Mapping::Mapping(const std::string& p)
+  : path(p)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+
+  if (fd == -1)
+    throw mapping_error("could not open", path);
+
+  struct stat st;
+
+  if (::fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+  {
+    ::close(fd);
+    throw mapping_error("not a regular file", path);
+  }
+
+  size = static_cast<size_t>(st.st_size);
+
+  if (size > 0)
+  {
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (addr == MAP_FAILED)
+    {
+      ::close(fd);
+      throw mapping_error("could not map", path);
+    }
+
+    // the file is read once from start to end
+    ::madvise(addr, size, MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(addr);
+  }
+
+  // the mapping remains valid after the descriptor is closed
+  ::close(fd);
+}
+
+SourceFile::Mapping::~Mapping()
+{
+  if (data)
+    ::munmap(const_cast<char*>(data), size);
+}
+
+#endif
+
+/*!
+ * \class SourceFile
+ */
+
+/*!
+ * \fn SourceFile(const std::string& path)
+ * \param the path of the file
+ * \brief maps a file in memory
+ *
+ * Throws std::runtime_error if the file cannot be opened or mapped.
+ */
+SourceFile::SourceFile(const std::string& path)
+  : m_mapping(std::make_shared<const Mapping>(path))
+{
+
+}
+
+/*!
+ * \fn const std::string& path() const
+ * \brief returns the path of the file
+ */
+const std::string& SourceFile::path() const
+{
+  static const std::string empty_path;
+  return m_mapping ? m_mapping->path : empty_path;
+}
+
+/*!
+ * \fn const char* data() const
+ * \brief returns a pointer to the content of the file
+ *
+ * The content is not null-terminated and the pointer is null
+ * if the file is empty.
+ */
+const char* SourceFile::data() const
+{
+  return m_mapping ? m_mapping->data : nullptr;
+}
+
+/*!
+ * \fn size_t size() const
+ * \brief returns the size of the file
+ */
+size_t SourceFile::size() const
+{
+  return m_mapping ? m_mapping->size : 0;
+}
+
+/*!
+ * \fn TokenizedFile tokenize() const
+ * \brief tokenizes the file
+ *
+ * The file is read directly from the mapping, without any copy.
+ * The returned object shares ownership of the mapping.
+ */
+TokenizedFile SourceFile::tokenize() const
+{
+  Tokenizer lexer;
+  return tokenize(lexer);
+}
+
+/*!
+ * \fn TokenizedFile tokenize(Tokenizer& lexer) const
+ * \param the tokenizer to use
+ * \brief tokenizes the file using an existing tokenizer
+ *
+ * The tokenizer is reset before use; reusing the same tokenizer for
+ * several files avoids reallocating its output vector.
+ */
+TokenizedFile SourceFile::tokenize(Tokenizer& lexer) const
+{
+  lexer.reset();
+
+  LineIndex lines;
+  lexer.tokenizeBuffer(data(), size(), &lines);
+
+  TokenBuffer tokens{ text() };
+  tokens.reserve(lexer.output.size());
+  tokens.append(lexer.output);
+
+  return TokenizedFile(*this, std::move(tokens), std::move(lines));
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \class TokenizedFile
+ */
+
+/*!
+ * \fn TokenizedFile(SourceFile file, TokenBuffer tokens, LineIndex lines)
+ * \param the source file
+ * \param the tokens of the file
+ * \param the line index of the file
+ * \brief constructs a tokenized file
+ */
+TokenizedFile::TokenizedFile(SourceFile file, TokenBuffer tokens, LineIndex lines)
+  : m_file(std::move(file)),
+    m_tokens(std::move(tokens)),
+    m_lines(std::move(lines))
+{
+
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
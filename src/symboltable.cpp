@@ -0,0 +1,258 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/symboltable.h"
+
+#include <mutex>
+#include <stdexcept>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*
+ * A shard is an open-addressing hash table (linear probing) of ids;
+ * the names are copied in chunks of memory that are never reallocated.
+ */
+class SymbolTable::Shard
+{
+public:
+  struct Slot
+  {
+    uint64_t hash;
+    uint32_t id;
+  };
+
+  std::mutex mutex;
+  std::vector<Slot> slots = std::vector<Slot>(64, Slot{ 0, NoSymbol });
+  std::vector<string_view> names;
+  std::vector<std::unique_ptr<char[]>> chunks;
+  size_t chunk_used = ChunkSize;
+
+  static constexpr size_t ChunkSize = 64 * 1024;
+
+  uint32_t find(string_view name, uint64_t hash) const
+  {
+    const size_t mask = slots.size() - 1;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+      const Slot& slot = slots[i];
+
+      if (slot.id == NoSymbol)
+        return NoSymbol;
+      else if (slot.hash == hash && names[slot.id] == name)
+        return slot.id;
+    }
+  }
+
+  uint32_t insert(string_view name, uint64_t hash)
+  {
+    const size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+
+    for (; slots[i].id != NoSymbol; i = (i + 1) & mask)
+    {
+      if (slots[i].hash == hash && names[slots[i].id] == name)
+        return slots[i].id;
+    }
+
+    const uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(store(name));
+    slots[i] = Slot{ hash, id };
+
+    // keeps the load factor below 1/2
+    if (names.size() * 2 > slots.size())
+      grow();
+
+    return id;
+  }
+
+  string_view store(string_view name)
+  {
+    if (name.empty())
+      return string_view();
+
+    if (name.size() > ChunkSize / 4)
+    {
+      chunks.emplace_back(new char[name.size()]);
+      std::memcpy(chunks.back().get(), name.data(), name.size());
+      const string_view result{ chunks.back().get(), name.size() };
+
+      // keeps the current chunk last
+      if (chunks.size() > 1)
+        std::swap(chunks[chunks.size() - 1], chunks[chunks.size() - 2]);
+
+      return result;
+    }
+
+    if (chunk_used + name.size() > ChunkSize)
+    {
+      chunks.emplace_back(new char[ChunkSize]);
+      chunk_used = 0;
+    }
+
+    char* dest = chunks.back().get() + chunk_used;
+    std::memcpy(dest, name.data(), name.size());
+    chunk_used += name.size();
+    return string_view(dest, name.size());
+  }
+
+  void grow()
+  {
+    std::vector<Slot> old = std::vector<Slot>(slots.size() * 2, Slot{ 0, NoSymbol });
+    std::swap(old, slots);
+
+    const size_t mask = slots.size() - 1;
+
+    for (const Slot& slot : old)
+    {
+      if (slot.id == NoSymbol)
+        continue;
+
+      size_t i = slot.hash & mask;
+
+      while (slots[i].id != NoSymbol)
+        i = (i + 1) & mask;
+
+      slots[i] = slot;
+    }
+  }
+};
+
+/*!
+ * \class SymbolTable
+ */
+
+/*!
+ * \fn SymbolTable(bool concurrent)
+ * \param whether the table is shared between threads
+ * \brief constructs an empty symbol table
+ */
+SymbolTable::SymbolTable(bool concurrent)
+  : m_shard_bits(concurrent ? 4 : 0)
+{
+  for (size_t i(0); i < (size_t(1) << m_shard_bits); ++i)
+    m_shards.push_back(std::make_unique<Shard>());
+}
+
+SymbolTable::~SymbolTable() = default;
+
+/*!
+ * \fn bool isConcurrent() const
+ * \brief returns whether the table can be shared between threads
+ */
+bool SymbolTable::isConcurrent() const
+{
+  return m_shard_bits > 0;
+}
+
+/*!
+ * \fn uint32_t intern(string_view name, uint64_t hash)
+ * \param the name
+ * \param the hash of the name, as returned by hash()
+ * \brief returns the id of a name, adding it to the table if needed
+ *
+ * Throws std::length_error if the table is full.
+ */
+uint32_t SymbolTable::intern(string_view name, uint64_t hash)
+{
+  const size_t s = m_shard_bits ? hash >> (64 - m_shard_bits) : 0;
+  Shard& shard = *m_shards[s];
+
+  std::unique_lock<std::mutex> lock{ shard.mutex, std::defer_lock };
+
+  if (isConcurrent())
+    lock.lock();
+
+  // the id is the index of the name in its shard, followed by the shard number
+  if (shard.names.size() >= (NoSymbol >> m_shard_bits))
+  {
+    const uint32_t id = shard.find(name, hash);
+
+    if (id == NoSymbol)
+      throw std::length_error("SymbolTable: too many symbols");
+
+    return (id << m_shard_bits) | static_cast<uint32_t>(s);
+  }
+
+  return (shard.insert(name, hash) << m_shard_bits) | static_cast<uint32_t>(s);
+}
+
+/*!
+ * \fn uint32_t find(string_view name) const
+ * \brief returns the id of a name
+ *
+ * Returns NoSymbol if the name is not in the table.
+ */
+uint32_t SymbolTable::find(string_view name) const
+{
+  const uint64_t h = hash(name);
+  const size_t s = m_shard_bits ? h >> (64 - m_shard_bits) : 0;
+  Shard& shard = *m_shards[s];
+
+  std::unique_lock<std::mutex> lock{ shard.mutex, std::defer_lock };
+
+  if (isConcurrent())
+    lock.lock();
+
+  const uint32_t id = shard.find(name, h);
+  return id == NoSymbol ? NoSymbol : (id << m_shard_bits) | static_cast<uint32_t>(s);
+}
+
+/*!
+ * \fn string_view name(uint32_t id) const
+ * \brief returns the name that has the given id
+ *
+ * Throws std::out_of_range if \c id was not returned by the table.
+ */
+string_view SymbolTable::name(uint32_t id) const
+{
+  Shard& shard = *m_shards[id & ((uint32_t(1) << m_shard_bits) - 1)];
+  const uint32_t i = id >> m_shard_bits;
+
+  std::unique_lock<std::mutex> lock{ shard.mutex, std::defer_lock };
+
+  if (isConcurrent())
+    lock.lock();
+
+  if (id == NoSymbol || i >= shard.names.size())
+    throw std::out_of_range("SymbolTable::name()");
+
+  return shard.names[i];
+}
+
+/*!
+ * \fn size_t size() const
+ * \brief returns the number of names in the table
+ */
+size_t SymbolTable::size() const
+{
+  size_t n = 0;
+
+  for (const std::unique_ptr<Shard>& shard : m_shards)
+  {
+    std::unique_lock<std::mutex> lock{ shard->mutex, std::defer_lock };
+
+    if (isConcurrent())
+      lock.lock();
+
+    n += shard->names.size();
+  }
+
+  return n;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
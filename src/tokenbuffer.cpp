@@ -0,0 +1,126 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/tokenbuffer.h"
+
+#include <algorithm>
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+/*!
+ * \class TokenBuffer
+ */
+
+/*!
+ * \fn void setSource(string_view source)
+ * \param the new source string
+ * \brief changes the source string of the buffer
+ *
+ * Offsets are not modified, this is typically used when the source string
+ * has been moved to a different address.
+ */
+void TokenBuffer::setSource(string_view source)
+{
+  m_source = source;
+}
+
+/*!
+ * \fn void reserve(size_t n)
+ * \brief reserves memory for n tokens
+ */
+void TokenBuffer::reserve(size_t n)
+{
+  m_offsets.reserve(n);
+  m_lengths.reserve(n);
+  m_types.reserve(n);
+}
+
+/*!
+ * \fn void clear()
+ * \brief removes all tokens from the buffer
+ *
+ * The source string is left unchanged.
+ */
+void TokenBuffer::clear()
+{
+  m_offsets.clear();
+  m_lengths.clear();
+  m_types.clear();
+  m_long_tokens.clear();
+}
+
+/*!
+ * \fn void shrink_to_fit()
+ * \brief releases unused memory
+ */
+void TokenBuffer::shrink_to_fit()
+{
+  m_offsets.shrink_to_fit();
+  m_lengths.shrink_to_fit();
+  m_types.shrink_to_fit();
+  m_long_tokens.shrink_to_fit();
+}
+
+/*!
+ * \fn void append(const std::vector<Token>& tokens)
+ * \brief appends tokens to the buffer
+ *
+ * The text of all the tokens must be part of the source string of the buffer.
+ */
+void TokenBuffer::append(const std::vector<Token>& tokens)
+{
+  for (const Token& tok : tokens)
+    push_back(tok);
+}
+
+/*!
+ * \fn Token at(size_t i) const
+ * \brief returns the i-th token
+ *
+ * Throws std::out_of_range if \c i is not a valid index.
+ */
+Token TokenBuffer::at(size_t i) const
+{
+  if (i >= size())
+    throw std::out_of_range("TokenBuffer::at()");
+
+  return (*this)[i];
+}
+
+/*!
+ * \fn size_t memoryUsage() const
+ * \brief returns the number of bytes allocated by the buffer
+ */
+size_t TokenBuffer::memoryUsage() const
+{
+  return m_offsets.capacity() * sizeof(uint32_t)
+    + m_lengths.capacity() * sizeof(uint16_t)
+    + m_types.capacity() * sizeof(unsigned char)
+    + m_long_tokens.capacity() * sizeof(std::pair<uint32_t, size_t>);
+}
+
+size_t TokenBuffer::longTokenLength(size_t i) const
+{
+  auto it = std::lower_bound(m_long_tokens.begin(), m_long_tokens.end(), i,
+    [](const std::pair<uint32_t, size_t>& entry, size_t index) {
+      return entry.first < index;
+    });
+
+  return it->second;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
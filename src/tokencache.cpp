@@ -0,0 +1,453 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/tokencache.h"
+
+#include "cpptok/tokenizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+static const char token_cache_extension[] = ".tokens";
+
+static bool is_cache_entry(const fs::directory_entry& e)
+{
+  std::error_code ec;
+  return e.is_regular_file(ec) && e.path().extension() == token_cache_extension;
+}
+
+// temporary files of TokenStream::write() that are older than this are
+// left over by crashed writers
+static constexpr std::chrono::minutes stale_temporary_age{ 10 };
+
+static bool is_temporary_file(const fs::directory_entry& e)
+{
+  std::error_code ec;
+  const std::string name = e.path().filename().string();
+  return e.is_regular_file(ec) && e.path().extension() == ".tmp"
+    && name.find(std::string(token_cache_extension) + ".") != std::string::npos;
+}
+
+static void remove_stale_temporary_file(const fs::directory_entry& e)
+{
+  std::error_code ec;
+  const fs::file_time_type time = e.last_write_time(ec);
+
+  if (!ec && time < fs::file_time_type::clock::now() - stale_temporary_age)
+    fs::remove(e.path(), ec);
+}
+
+// records the use of an entry
+static void touch(const std::string& path)
+{
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+}
+
+/*!
+ * \class TokenCache
+ */
+
+/*!
+ * \fn TokenCache(const std::string& directory, uint64_t max_size)
+ * \param the cache directory
+ * \param the maximum size of the entries, in bytes
+ * \brief opens a cache directory, creating it if needed
+ *
+ * Throws std::runtime_error if the directory cannot be created.
+ */
+TokenCache::TokenCache(const std::string& directory, uint64_t max_size)
+  : m_directory(directory),
+    m_max_size(max_size)
+{
+  std::error_code ec;
+  fs::create_directories(directory, ec);
+
+  if (!fs::is_directory(directory, ec))
+    throw std::runtime_error("TokenCache: could not create " + directory);
+
+  for (const fs::directory_entry& e : fs::directory_iterator(directory, ec))
+  {
+    if (!is_cache_entry(e))
+      continue;
+
+    const uint64_t size = e.file_size(ec);
+    m_entries[e.path().string()] = Entry{ size, 0 };
+    m_size += size;
+  }
+}
+
+/*!
+ * \fn const std::string& directory() const
+ * \brief returns the cache directory
+ */
+const std::string& TokenCache::directory() const
+{
+  return m_directory;
+}
+
+/*!
+ * \fn uint64_t maxSize() const
+ * \brief returns the maximum size of the entries, in bytes
+ */
+uint64_t TokenCache::maxSize() const
+{
+  std::lock_guard<std::mutex> lock{ m_mutex };
+  return m_max_size;
+}
+
+/*!
+ * \fn void setMaxSize(uint64_t max_size)
+ * \brief changes the maximum size of the entries
+ *
+ * Entries are evicted if the cache is now too large.
+ */
+void TokenCache::setMaxSize(uint64_t max_size)
+{
+  {
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    m_max_size = max_size;
+  }
+
+  evict();
+}
+
+/*!
+ * \fn uint64_t size() const
+ * \brief returns the total size of the entries, in bytes
+ *
+ * Entries added or removed by other processes are only taken into
+ * account by evict().
+ */
+uint64_t TokenCache::size() const
+{
+  std::lock_guard<std::mutex> lock{ m_mutex };
+  return m_size;
+}
+
+/*!
+ * \fn std::string entryPath(string_view source) const
+ * \brief returns the path of the entry of a source
+ */
+std::string TokenCache::entryPath(string_view source) const
+{
+  return entryPath(TokenStream::hash(source), source.size());
+}
+
+std::string TokenCache::entryPath(uint64_t hash, size_t size) const
+{
+  char name[64];
+  std::snprintf(name, sizeof(name), "%016llx-%llx%s", static_cast<unsigned long long>(hash),
+    static_cast<unsigned long long>(size), token_cache_extension);
+  return (fs::path(m_directory) / name).string();
+}
+
+/*!
+ * \fn TokenStream find(string_view source)
+ * \param the source
+ * \brief returns the cached tokens of a source
+ *
+ * Returns a null TokenStream if the source is not in the cache.
+ */
+TokenStream TokenCache::find(string_view source)
+{
+  return find(source, TokenStream::hash(source));
+}
+
+TokenStream TokenCache::find(string_view source, uint64_t hash)
+{
+  const std::string path = entryPath(hash, source.size());
+  std::error_code ec;
+
+  if (!fs::exists(path, ec))
+  {
+    ++m_misses;
+    return TokenStream();
+  }
+
+  TokenStream stream;
+
+  try
+  {
+    stream = TokenStream(path);
+  }
+  catch (const std::runtime_error&)
+  {
+    // corrupted entries (or entries of an older version) are ignored,
+    // and replaced by the next insert()
+    ++m_misses;
+    return TokenStream();
+  }
+
+  if (stream.sourceSize() != source.size() || stream.sourceHash() != hash)
+  {
+    ++m_misses;
+    return TokenStream();
+  }
+
+  touch(path);
+  ++m_hits;
+  return stream;
+}
+
+/*!
+ * \fn TokenStream insert(string_view source, const TokenBuffer& tokens, const LineIndex* lines)
+ * \param the source
+ * \param its tokens
+ * \param the line index of the source, computed if null
+ * \brief adds the tokens of a source to the cache
+ *
+ * Returns the new entry. Least recently used entries are evicted if the
+ * cache becomes too large.
+ */
+TokenStream TokenCache::insert(string_view source, const TokenBuffer& tokens, const LineIndex* lines)
+{
+  return insert(source, TokenStream::hash(source), tokens, lines);
+}
+
+TokenStream TokenCache::insert(string_view source, uint64_t hash, const TokenBuffer& tokens, const LineIndex* lines)
+{
+  const std::string path = entryPath(hash, source.size());
+
+  TokenStream::write(path, source, tokens, lines);
+  TokenStream stream{ path };
+
+  bool too_large = false;
+
+  {
+    // the size of the entry replaced by the rename, if any, is the one
+    // recorded by the previous insert, so that concurrent inserts of the
+    // same source count the entry once
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    Entry& entry = m_entries[path];
+    m_size -= entry.size;
+    entry.size = stream.file().size();
+    entry.insertion = ++m_insertions;
+    m_size += entry.size;
+    too_large = m_size > m_max_size;
+  }
+
+  if (too_large)
+    evict();
+
+  return stream;
+}
+
+/*!
+ * \fn TokenStream tokenize(string_view source)
+ * \param the source
+ * \brief returns the tokens of a source, from the cache if possible
+ *
+ * If the source is not in the cache, it is tokenized with
+ * Tokenizer::tokenizeBuffer() and added to the cache.
+ */
+TokenStream TokenCache::tokenize(string_view source)
+{
+  Tokenizer lexer;
+  return tokenize(source, lexer);
+}
+
+/*!
+ * \fn TokenStream tokenize(string_view source, Tokenizer& lexer)
+ * \param the source
+ * \param the tokenizer used if the source is not in the cache
+ * \brief returns the tokens of a source, from the cache if possible
+ *
+ * The tokenizer is reset before being used.
+ */
+TokenStream TokenCache::tokenize(string_view source, Tokenizer& lexer)
+{
+  const uint64_t hash = TokenStream::hash(source);
+  TokenStream stream = find(source, hash);
+
+  if (!stream.isNull())
+    return stream;
+
+  LineIndex lines;
+  lexer.reset();
+  lexer.tokenizeBuffer(source.data(), source.size(), &lines);
+
+  TokenBuffer tokens{ source };
+  tokens.append(lexer.output);
+  lexer.output.clear();
+
+  return insert(source, hash, tokens, &lines);
+}
+
+/*!
+ * \fn size_t hits() const
+ * \brief returns the number of sources found in the cache
+ */
+size_t TokenCache::hits() const
+{
+  return m_hits.load();
+}
+
+/*!
+ * \fn size_t misses() const
+ * \brief returns the number of sources that were not found in the cache
+ */
+size_t TokenCache::misses() const
+{
+  return m_misses.load();
+}
+
+/*!
+ * \fn void evict()
+ * \brief removes the least recently used entries if the cache exceeds its maximum size
+ *
+ * Entries are removed until the cache is at most 90% of its maximum size.
+ * The directory is scanned again, which takes into account the entries
+ * added by other processes. Temporary files left over by writers that
+ * crashed are removed as well.
+ *
+ * The directory is scanned without holding the lock of the cache, so
+ * that other threads can keep inserting entries.
+ */
+void TokenCache::evict()
+{
+  struct File
+  {
+    std::string path;
+    fs::file_time_type time;
+    uint64_t size;
+  };
+
+  uint64_t max_size = 0;
+  uint64_t insertions = 0;
+
+  {
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    max_size = m_max_size;
+    insertions = m_insertions;
+  }
+
+  std::vector<File> files;
+  uint64_t total = 0;
+  std::error_code ec;
+
+  for (const fs::directory_entry& e : fs::directory_iterator(m_directory, ec))
+  {
+    if (is_temporary_file(e))
+      remove_stale_temporary_file(e);
+
+    if (!is_cache_entry(e))
+      continue;
+
+    File file{ e.path().string(), e.last_write_time(ec), e.file_size(ec) };
+    total += file.size;
+    files.push_back(std::move(file));
+  }
+
+  std::vector<std::pair<std::string, uint64_t>> kept;
+  kept.reserve(files.size());
+
+  if (total > max_size)
+  {
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
+      return a.time < b.time;
+      });
+
+    // going below the maximum size leaves room for the next entries, so
+    // that a full cache is not scanned again on every insert
+    const uint64_t target = max_size - max_size / 10;
+
+    for (const File& f : files)
+    {
+      if (total > target && fs::remove(f.path, ec))
+        total -= f.size;
+      else
+        kept.emplace_back(f.path, f.size);
+    }
+  }
+  else
+  {
+    for (const File& f : files)
+      kept.emplace_back(f.path, f.size);
+  }
+
+  update(kept, insertions);
+}
+
+/*!
+ * \fn void clear()
+ * \brief removes all the entries of the cache
+ *
+ * Temporary files that are being written by other threads or processes
+ * are kept, only those left over by writers that crashed are removed.
+ * Entries inserted by other threads while the directory is scanned may
+ * be kept.
+ */
+void TokenCache::clear()
+{
+  uint64_t insertions = 0;
+
+  {
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    insertions = m_insertions;
+  }
+
+  std::error_code ec;
+
+  for (const fs::directory_entry& e : fs::directory_iterator(m_directory, ec))
+  {
+    if (is_cache_entry(e))
+      fs::remove(e.path(), ec);
+    else if (is_temporary_file(e))
+      remove_stale_temporary_file(e);
+  }
+
+  update({}, insertions);
+}
+
+// replaces the entries of the cache by the files found in the directory,
+// keeping the entries inserted after the directory was scanned (i.e. after
+// m_insertions was equal to insertions) if they still exist
+void TokenCache::update(const std::vector<std::pair<std::string, uint64_t>>& files, uint64_t insertions)
+{
+  std::unordered_map<std::string, Entry> entries;
+  entries.reserve(files.size());
+
+  for (const std::pair<std::string, uint64_t>& f : files)
+    entries[f.first] = Entry{ f.second, 0 };
+
+  std::lock_guard<std::mutex> lock{ m_mutex };
+
+  for (const std::pair<const std::string, Entry>& e : m_entries)
+  {
+    std::error_code ec;
+
+    if (e.second.insertion > insertions && fs::exists(e.first, ec))
+      entries[e.first] = e.second;
+  }
+
+  m_entries = std::move(entries);
+  m_size = 0;
+
+  for (const std::pair<const std::string, Entry>& e : m_entries)
+    m_size += e.second.size;
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
@@ -0,0 +1,446 @@
+// Copyright (C) 2022 Vincent Chambrin
+// This file is part of the 'cpptok' project
+// For conditions of distribution and use, see copyright notice in LICENSE
+
+#include "cpptok/tokenstream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+/*!
+ * \namespace cpptok
+ */
+
+namespace cpptok
+{
+
+static constexpr char token_stream_magic[8] = { 'C', 'P', 'P', 'T', 'O', 'K', 'T', 'S' };
+static constexpr uint32_t token_stream_byte_order = 0x01020304;
+
+struct TokenStream::Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t source_size;
+  uint64_t source_hash;
+  uint64_t token_count;
+  uint64_t long_token_count;
+  uint64_t line_count;
+  // offsets of the columns in the file
+  uint64_t types;
+  uint64_t offsets;
+  uint64_t lengths;
+  uint64_t long_tokens;
+  uint64_t line_starts;
+};
+
+static uint64_t align8(uint64_t n)
+{
+  return (n + 7) & ~uint64_t(7);
+}
+
+static unsigned long long process_id()
+{
+#if defined(_WIN32)
+  return GetCurrentProcessId();
+#else
+  return static_cast<unsigned long long>(getpid());
+#endif
+}
+
+// returns a temporary name for a file, unique to the process and the call
+static std::string temporary_path(const std::string& path)
+{
+  static std::atomic<unsigned long long> counter{ 0 };
+  return path + "." + std::to_string(process_id()) + "-" + std::to_string(++counter) + ".tmp";
+}
+
+/*!
+ * \class TokenStream
+ */
+
+/*!
+ * \fn TokenStream(const std::string& path)
+ * \param the path of a token stream file
+ * \brief maps a token stream file
+ *
+ * Throws std::runtime_error if the file cannot be mapped or is not a valid
+ * token stream of the current version. Every token is checked to lie within
+ * the source, which costs a pass over the offsets and lengths columns.
+ */
+TokenStream::TokenStream(const std::string& path)
+  : m_file(path)
+{
+  auto fail = [&path](const char* reason) {
+    return std::runtime_error(std::string("TokenStream: ") + reason + ": " + path);
+  };
+
+  if (m_file.size() < sizeof(Header))
+    throw fail("file is too small");
+
+  const Header* h = reinterpret_cast<const Header*>(m_file.data());
+
+  if (std::memcmp(h->magic, token_stream_magic, sizeof(token_stream_magic)) != 0)
+    throw fail("not a token stream");
+  else if (h->byte_order != token_stream_byte_order)
+    throw fail("unsupported byte order");
+  else if (h->version != Version)
+    throw fail("unsupported version");
+
+  const uint64_t size = m_file.size();
+
+  // checks that a column of count elements of the given size lies in the file
+  auto check = [&](uint64_t offset, uint64_t count, uint64_t element_size) {
+    if (offset % 8 != 0 || offset < sizeof(Header) || offset > size || count > (size - offset) / element_size)
+      throw fail("corrupted file");
+  };
+
+  check(h->types, h->token_count, 1);
+  check(h->offsets, h->token_count, sizeof(uint32_t));
+  check(h->lengths, h->token_count, sizeof(uint16_t));
+  check(h->long_tokens, h->long_token_count, 2 * sizeof(uint64_t));
+  check(h->line_starts, h->line_count, sizeof(uint64_t));
+
+  const unsigned char* types = reinterpret_cast<const unsigned char*>(m_file.data() + h->types);
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(m_file.data() + h->offsets);
+  const uint16_t* lengths = reinterpret_cast<const uint16_t*>(m_file.data() + h->lengths);
+  const uint64_t* long_tokens = reinterpret_cast<const uint64_t*>(m_file.data() + h->long_tokens);
+  const uint64_t* line_starts = reinterpret_cast<const uint64_t*>(m_file.data() + h->line_starts);
+
+  // every token must lie in the source, so that token() never reads past
+  // it; the long tokens must be the tokens whose length is LongToken, in
+  // order, so that longTokenLength() finds them
+  uint64_t k = 0;
+
+  for (uint64_t i(0); i < h->token_count; ++i)
+  {
+    uint64_t length = lengths[i];
+
+    if (length == TokenBuffer::LongToken)
+    {
+      if (k == h->long_token_count || long_tokens[2 * k] != i)
+        throw fail("corrupted file");
+
+      length = long_tokens[2 * k + 1];
+      ++k;
+    }
+
+    if (offsets[i] > h->source_size || length > h->source_size - offsets[i])
+      throw fail("corrupted file");
+  }
+
+  if (k != h->long_token_count)
+    throw fail("corrupted file");
+
+  if (h->line_count > 0 && line_starts[h->line_count - 1] > h->source_size)
+    throw fail("corrupted file");
+
+  m_header = h;
+  m_types = types;
+  m_offsets = offsets;
+  m_lengths = lengths;
+  m_long_tokens = long_tokens;
+  m_line_starts = line_starts;
+}
+
+template<typename T>
+static void write_column(std::ostream& out, const std::vector<T>& column)
+{
+  static const char padding[8] = {};
+
+  const size_t bytes = column.size() * sizeof(T);
+  out.write(reinterpret_cast<const char*>(column.data()), bytes);
+  out.write(padding, align8(bytes) - bytes);
+}
+
+/*!
+ * \fn static void write(std::ostream& out, string_view source, const TokenBuffer& tokens, const LineIndex* lines)
+ * \param the output stream, which must be opened in binary mode
+ * \param the source of the tokens
+ * \param the tokens
+ * \param the line index of the source, computed if null
+ * \brief writes a token stream
+ */
+void TokenStream::write(std::ostream& out, string_view source, const TokenBuffer& tokens, const LineIndex* lines)
+{
+  LineIndex computed_lines;
+
+  if (!lines)
+  {
+    computed_lines.build(source.data(), source.size());
+    lines = &computed_lines;
+  }
+
+  const size_t n = tokens.size();
+
+  std::vector<unsigned char> types(n);
+  std::vector<uint32_t> offsets(n);
+  std::vector<uint16_t> lengths(n);
+  std::vector<uint64_t> long_tokens;
+
+  for (size_t i(0); i < n; ++i)
+  {
+    types[i] = tokens.type(i).code();
+    offsets[i] = static_cast<uint32_t>(tokens.offset(i));
+
+    const size_t l = tokens.length(i);
+
+    if (l < TokenBuffer::LongToken)
+    {
+      lengths[i] = static_cast<uint16_t>(l);
+    }
+    else
+    {
+      lengths[i] = TokenBuffer::LongToken;
+      long_tokens.push_back(i);
+      long_tokens.push_back(l);
+    }
+  }
+
+  const std::vector<uint64_t> line_starts{ lines->lineStarts().begin(), lines->lineStarts().end() };
+
+  static_assert(sizeof(Header) == 96, "the header of token streams must not have padding");
+
+  Header h;
+  std::memcpy(h.magic, token_stream_magic, sizeof(token_stream_magic));
+  h.version = Version;
+  h.byte_order = token_stream_byte_order;
+  h.source_size = source.size();
+  h.source_hash = hash(source);
+  h.token_count = n;
+  h.long_token_count = long_tokens.size() / 2;
+  h.line_count = line_starts.size();
+  h.types = sizeof(Header);
+  h.offsets = h.types + align8(n);
+  h.lengths = h.offsets + align8(n * sizeof(uint32_t));
+  h.long_tokens = h.lengths + align8(n * sizeof(uint16_t));
+  h.line_starts = h.long_tokens + long_tokens.size() * sizeof(uint64_t);
+
+  out.write(reinterpret_cast<const char*>(&h), sizeof(Header));
+  write_column(out, types);
+  write_column(out, offsets);
+  write_column(out, lengths);
+  write_column(out, long_tokens);
+  write_column(out, line_starts);
+}
+
+/*!
+ * \fn static void write(const std::string& path, string_view source, const TokenBuffer& tokens, const LineIndex* lines)
+ * \param the path of the file to write
+ * \param the source of the tokens
+ * \param the tokens
+ * \param the line index of the source, computed if null
+ * \brief writes a token stream file
+ *
+ * The file is first written under a temporary name (the path followed by
+ * the process id, a counter and ".tmp") and then renamed, so that readers
+ * never see a partially written file.
+ * Throws std::runtime_error if the file cannot be written.
+ */
+void TokenStream::write(const std::string& path, string_view source, const TokenBuffer& tokens, const LineIndex* lines)
+{
+  // the temporary name is unique, in case several threads or processes
+  // write the same file
+  const std::string tmp = temporary_path(path);
+
+  {
+    std::ofstream file{ tmp, std::ios::binary | std::ios::trunc };
+
+    if (file)
+      write(file, source, tokens, lines);
+
+    if (!file)
+      throw std::runtime_error("TokenStream: could not write " + tmp);
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+
+  if (ec)
+  {
+    std::filesystem::remove(tmp, ec);
+    throw std::runtime_error("TokenStream: could not write " + path);
+  }
+}
+
+/*!
+ * \fn static void write(const std::string& path, const TokenizedFile& file)
+ * \param the path of the file to write
+ * \param a tokenized source file
+ * \brief writes the tokens of a file in a token stream file
+ */
+void TokenStream::write(const std::string& path, const TokenizedFile& file)
+{
+  write(path, file.file().text(), file.tokens(), &file.lines());
+}
+
+/*!
+ * \fn static uint64_t hash(string_view source)
+ * \brief returns the hash of a source, as stored in token streams
+ *
+ * The source is read 8 bytes at a time.
+ */
+uint64_t TokenStream::hash(string_view source)
+{
+  constexpr uint64_t k1 = 0x9E3779B97F4A7C15;
+  constexpr uint64_t k2 = 0xFF51AFD7ED558CCD;
+
+  const char* p = source.data();
+  size_t n = source.size();
+  uint64_t h = n * k1;
+
+  for (; n >= 8; n -= 8, p += 8)
+  {
+    uint64_t w;
+    std::memcpy(&w, p, 8);
+    h ^= w * k2;
+    h = ((h << 31) | (h >> 33)) * k1;
+  }
+
+  if (n > 0)
+  {
+    uint64_t w = 0;
+    std::memcpy(&w, p, n);
+    h ^= w * k2;
+    h = ((h << 31) | (h >> 33)) * k1;
+  }
+
+  h ^= h >> 33;
+  h *= k2;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53;
+  h ^= h >> 33;
+  return h;
+}
+
+/*!
+ * \fn size_t sourceSize() const
+ * \brief returns the size of the source the tokens were computed from
+ */
+size_t TokenStream::sourceSize() const
+{
+  return m_header ? static_cast<size_t>(m_header->source_size) : 0;
+}
+
+/*!
+ * \fn uint64_t sourceHash() const
+ * \brief returns the hash of the source the tokens were computed from
+ */
+uint64_t TokenStream::sourceHash() const
+{
+  return m_header ? m_header->source_hash : 0;
+}
+
+/*!
+ * \fn bool matches(string_view source) const
+ * \brief returns whether the tokens were computed from the given source
+ *
+ * The size and the hash of the source are compared with those stored in
+ * the header.
+ */
+bool TokenStream::matches(string_view source) const
+{
+  return m_header && m_header->source_size == source.size() && m_header->source_hash == hash(source);
+}
+
+/*!
+ * \fn size_t size() const
+ * \brief returns the number of tokens
+ */
+size_t TokenStream::size() const
+{
+  return m_header ? static_cast<size_t>(m_header->token_count) : 0;
+}
+
+/*!
+ * \fn TokenBuffer toTokenBuffer(string_view source) const
+ * \param the source the tokens were computed from
+ * \brief copies the tokens into a TokenBuffer
+ */
+TokenBuffer TokenStream::toTokenBuffer(string_view source) const
+{
+  TokenBuffer result{ source };
+  result.reserve(size());
+
+  for (size_t i(0); i < size(); ++i)
+    result.push_back(type(i), offset(i), length(i));
+
+  return result;
+}
+
+/*!
+ * \fn size_t lineCount() const
+ * \brief returns the number of lines of the source
+ */
+size_t TokenStream::lineCount() const
+{
+  return m_header ? static_cast<size_t>(m_header->line_count) : 0;
+}
+
+/*!
+ * \fn size_t lineStart(size_t line) const
+ * \brief returns the offset of the first character of a line
+ */
+size_t TokenStream::lineStart(size_t line) const
+{
+  return static_cast<size_t>(m_line_starts[line]);
+}
+
+/*!
+ * \fn size_t lineOf(size_t offset) const
+ * \brief returns the line containing the character at the given offset
+ */
+size_t TokenStream::lineOf(size_t offset) const
+{
+  const uint64_t* end = m_line_starts + lineCount();
+  const uint64_t* it = std::upper_bound(m_line_starts, end, uint64_t(offset));
+  return it == m_line_starts ? 0 : static_cast<size_t>(it - m_line_starts) - 1;
+}
+
+size_t TokenStream::longTokenLength(size_t i) const
+{
+  size_t first = 0;
+  size_t last = static_cast<size_t>(m_header->long_token_count);
+
+  // binary search of the (index, length) pairs
+  while (first < last)
+  {
+    const size_t mid = first + (last - first) / 2;
+
+    if (m_long_tokens[2 * mid] < i)
+      first = mid + 1;
+    else
+      last = mid;
+  }
+
+  // cannot happen with a file accepted by the constructor
+  if (first == m_header->long_token_count || m_long_tokens[2 * first] != i)
+    throw std::runtime_error("TokenStream: corrupted file: " + m_file.path());
+
+  return static_cast<size_t>(m_long_tokens[2 * first + 1]);
+}
+
+/*!
+ * \endclass
+ */
+
+/*!
+ * \endnamespace
+ */
+
+} // namespace cpptok
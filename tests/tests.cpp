@@ -5,7 +5,31 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
 #include "cpptok/tokenizer.h"
+#include "cpptok/batchtokenizer.h"
+#include "cpptok/bracketindex.h"
+#include "cpptok/compressedtokenbuffer.h"
+#include "cpptok/dependencygraph.h"
+#include "cpptok/documenttokenizer.h"
+#include "cpptok/identifiertable.h"
+#include "cpptok/includescanner.h"
+#include "cpptok/json.h"
+#include "cpptok/lineindex.h"
+#include "cpptok/scan.h"
+#include "cpptok/sourcefile.h"
+#include "cpptok/symboltable.h"
+#include "cpptok/tokenbuffer.h"
+#include "cpptok/tokencache.h"
+#include "cpptok/tokenstream.h"
+#include "cpptok/tokensinks.h"
 
 TEST_CASE("Tokenize keywords", "[cpptok]")
 {
@@ -100,3 +124,1488 @@ TEST_CASE("Tokenize preprocessor directive", "[cpptok]")
   REQUIRE(lexer.output[1].type() == cpptok::TokenType::Include);
   REQUIRE(lexer.output[1].text() == "<vector>");
 }
+
+TEST_CASE("Tokenize identifiers resembling keywords", "[cpptok]")
+{
+  cpptok::Tokenizer lexer;
+  lexer.tokenize(" nullptr sizeof switch protected ");
+
+  REQUIRE(lexer.output.size() == 4);
+
+  for (const cpptok::Token& tok : lexer.output)
+  {
+    REQUIRE(tok.isKeyword());
+  }
+
+  lexer.output.clear();
+  lexer.tokenize(" i fo dp intt classs cons Auto sizeofs swatch protecded static_castt x1234567890123456 ");
+
+  REQUIRE(lexer.output.size() == 12);
+
+  for (const cpptok::Token& tok : lexer.output)
+  {
+    REQUIRE(tok.type() == cpptok::TokenType::UserDefinedName);
+  }
+}
+
+TEST_CASE("Tokenize operators", "[cpptok]")
+{
+  cpptok::Tokenizer lexer;
+  lexer.tokenize("a<<=b>>c<<<d!=-e&&&f||g+++h@");
+
+  std::vector<cpptok::TokenType> expected = {
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::LeftShiftEq,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::RightShift,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::LeftShift, cpptok::TokenType::Less,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::Neq, cpptok::TokenType::Minus,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::LogicalAnd, cpptok::TokenType::BitwiseAnd,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::LogicalOr,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::PlusPlus, cpptok::TokenType::Plus,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::Invalid,
+  };
+
+  REQUIRE(lexer.output.size() == expected.size());
+
+  for (size_t i(0); i < expected.size(); ++i)
+  {
+    REQUIRE(lexer.output[i].type() == expected[i]);
+  }
+
+  REQUIRE(lexer.output[1].text() == "<<=");
+  REQUIRE(lexer.output[6].text() == "<");
+}
+
+TEST_CASE("Scan whitespace", "[cpptok]")
+{
+  for (size_t len(0); len < 80; ++len)
+  {
+    for (size_t stop(0); stop <= len; ++stop)
+    {
+      std::string str;
+
+      for (size_t i(0); i < len; ++i)
+        str.push_back(" \t\r\n"[i % 4]);
+
+      if (stop < len)
+        str[stop] = 'x';
+
+      const char* result = cpptok::scan::skipWhitespace(str.data(), str.data() + str.size());
+      REQUIRE(result == str.data() + stop);
+    }
+  }
+}
+
+TEST_CASE("Tokenize indented code", "[cpptok]")
+{
+  cpptok::Tokenizer lexer;
+  lexer.tokenize("                                        \t\t\t\t  return 0;    \r\n");
+
+  REQUIRE(lexer.output.size() == 3);
+  REQUIRE(lexer.output[0].type() == cpptok::TokenType::Return);
+  REQUIRE(lexer.output[1].text() == "0");
+  REQUIRE(lexer.output[2].type() == cpptok::TokenType::Semicolon);
+}
+
+TEST_CASE("Scan for terminators", "[cpptok]")
+{
+  for (size_t len(0); len < 80; ++len)
+  {
+    for (size_t stop(0); stop <= len; ++stop)
+    {
+      std::string str(len, 'a');
+
+      if (stop + 1 < len)
+      {
+        str[stop] = '*';
+        str[stop + 1] = '/';
+      }
+
+      const char* begin = str.data();
+      const char* end = str.data() + str.size();
+      const char* expected = stop + 1 < len ? begin + stop : end;
+
+      REQUIRE(cpptok::scan::findPair(begin, end, '*', '/') == expected);
+      REQUIRE(cpptok::scan::findFirstOf(begin, end, '"', '/', '*') == expected);
+    }
+  }
+}
+
+TEST_CASE("Tokenize comments and strings", "[cpptok]")
+{
+  cpptok::Tokenizer lexer;
+  lexer.tokenize(R"(/**/ /*/ a */ /** doc **/ "a\"b\\" "x\n")");
+
+  REQUIRE(lexer.output.size() == 5);
+  REQUIRE(lexer.output[0].text() == "/**/");
+  REQUIRE(lexer.output[1].text() == "/*/ a */");
+  REQUIRE(lexer.output[2].text() == "/** doc **/");
+  REQUIRE(lexer.output[3].type() == cpptok::TokenType::StringLiteral);
+  REQUIRE(lexer.output[3].text() == R"("a\"b\\")");
+  REQUIRE(lexer.output[4].type() == cpptok::TokenType::StringLiteral);
+
+  lexer.output.clear();
+  lexer.tokenize("\"unterminated\nx // comment\n");
+
+  REQUIRE(lexer.output.size() == 3);
+  REQUIRE(lexer.output[0].type() == cpptok::TokenType::Invalid);
+  REQUIRE(lexer.output[0].text() == "\"unterminated");
+  REQUIRE(lexer.output[2].type() == cpptok::TokenType::SingleLineComment);
+  REQUIRE(lexer.output[2].text() == "// comment");
+
+  lexer.output.clear();
+  lexer.tokenize("/* long *");
+  lexer.tokenize("*/ x");
+
+  REQUIRE(lexer.output.size() == 3);
+  REQUIRE(lexer.state == cpptok::Tokenizer::Default);
+  REQUIRE(lexer.output[1].text() == "*/");
+}
+
+TEST_CASE("Scan identifiers", "[cpptok]")
+{
+  const std::string chars = "azAZ09_mM5";
+  const std::string stops = " @[`{/:\x7f\x80\xff";
+
+  for (size_t len(0); len < 80; ++len)
+  {
+    for (char stopchar : stops)
+    {
+      std::string str;
+
+      for (size_t i(0); i < len; ++i)
+        str.push_back(chars[i % chars.size()]);
+
+      str.push_back(stopchar);
+
+      const char* result = cpptok::scan::skipIdentifier(str.data(), str.data() + str.size());
+      REQUIRE(result == str.data() + len);
+    }
+  }
+}
+
+TEST_CASE("Tokenize long identifiers", "[cpptok]")
+{
+  const std::string name = "a_very_long_identifier_0123456789_ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  const std::string line = "#" + name + " " + name + "(1.5_" + name + ", \"str\"" + name + ")\xc3\xa9";
+
+  cpptok::Tokenizer lexer;
+  lexer.tokenize(line);
+
+  REQUIRE(lexer.output.size() == 9);
+  REQUIRE(lexer.output[0].type() == cpptok::TokenType::Preproc);
+  REQUIRE(lexer.output[0].text() == "#" + name);
+  REQUIRE(lexer.output[1].type() == cpptok::TokenType::UserDefinedName);
+  REQUIRE(lexer.output[1].text() == name);
+  REQUIRE(lexer.output[3].type() == cpptok::TokenType::UserDefinedLiteral);
+  REQUIRE(lexer.output[3].text() == "1.5_" + name);
+  REQUIRE(lexer.output[5].type() == cpptok::TokenType::UserDefinedLiteral);
+  REQUIRE(lexer.output[5].text() == "\"str\"" + name);
+  REQUIRE(lexer.output[7].type() == cpptok::TokenType::Invalid);
+  REQUIRE(lexer.output[8].type() == cpptok::TokenType::Invalid);
+}
+
+TEST_CASE("Token type codes", "[cpptok]")
+{
+  REQUIRE(cpptok::TokenType(cpptok::TokenType::Invalid).code() == 0);
+
+  for (int i(0); i < cpptok::TokenType::CodeCount; ++i)
+  {
+    cpptok::TokenType t = cpptok::TokenType::fromCode(static_cast<unsigned char>(i));
+    REQUIRE(t.code() == i);
+  }
+
+  REQUIRE(cpptok::TokenType::fromCode(255) == cpptok::TokenType::Invalid);
+  REQUIRE(cpptok::TokenType(cpptok::TokenType::SingleLineComment).code() != cpptok::TokenType(cpptok::TokenType::LogicalAnd).code());
+}
+
+TEST_CASE("Token buffer", "[cpptok]")
+{
+  const std::string source = "int a = 0; /*" + std::string(100000, '*') + "*/ return a;\n";
+
+  cpptok::Tokenizer lexer;
+  lexer.tokenize(source);
+
+  cpptok::TokenBuffer buffer{ source };
+  buffer.append(lexer.output);
+
+  REQUIRE(buffer.size() == lexer.output.size());
+  REQUIRE(buffer.size() == 9);
+
+  for (size_t i(0); i < buffer.size(); ++i)
+  {
+    REQUIRE(buffer[i] == lexer.output[i]);
+  }
+
+  REQUIRE(buffer.length(5) == 100004);
+  REQUIRE(buffer.type(5) == cpptok::TokenType::MultiLineComment);
+  REQUIRE(buffer.offset(6) == source.find("return"));
+
+  std::vector<cpptok::Token> tokens{ buffer.begin(), buffer.end() };
+  REQUIRE(tokens == lexer.output);
+
+  REQUIRE_THROWS_AS(buffer.at(9), std::out_of_range);
+}
+
+TEST_CASE("Tokenize buffer", "[cpptok]")
+{
+  const std::string source =
+    "#include <vector>\n"
+    "#\n"
+    "define X\n"
+    "/* a\n"
+    "   b */ int\n"
+    "  main() { return 0; }\n"
+    "#include \"unterminated\n"
+    "x";
+
+  cpptok::Tokenizer lexer;
+  cpptok::LineIndex lines;
+  lexer.tokenizeBuffer(source, &lines);
+
+  REQUIRE(lexer.state == cpptok::Tokenizer::Default);
+  REQUIRE(lines.lineCount() == 8);
+
+  std::vector<cpptok::TokenType> types;
+  std::vector<size_t> token_lines;
+
+  for (const cpptok::Token& tok : lexer.output)
+  {
+    types.push_back(tok.type());
+    token_lines.push_back(lines.lineOf(tok.text().data() - source.data()));
+  }
+
+  REQUIRE(types == std::vector<cpptok::TokenType>{
+    cpptok::TokenType::Preproc, cpptok::TokenType::Include,
+    cpptok::TokenType::Invalid,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::UserDefinedName,
+    cpptok::TokenType::MultiLineComment, cpptok::TokenType::Int,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::LeftPar, cpptok::TokenType::RightPar,
+    cpptok::TokenType::LeftBrace, cpptok::TokenType::Return, cpptok::TokenType::Zero,
+    cpptok::TokenType::Semicolon, cpptok::TokenType::RightBrace,
+    cpptok::TokenType::Preproc, cpptok::TokenType::Invalid,
+    cpptok::TokenType::UserDefinedName,
+  });
+
+  REQUIRE(token_lines == std::vector<size_t>{ 0, 0, 1, 2, 2, 3, 4, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 7 });
+  REQUIRE(lexer.output[1].text() == "<vector>");
+  REQUIRE(lexer.output[16].text() == "\"unterminated");
+
+  const size_t main_offset = source.find("main");
+  REQUIRE(lines.columnOf(main_offset) == 2);
+  REQUIRE(lines.lineStart(5) + 2 == main_offset);
+  REQUIRE(lines.lineOf(source.size()) == 7);
+}
+
+TEST_CASE("Scan for all occurrences", "[cpptok]")
+{
+  std::string text(200, 'a');
+  std::vector<size_t> expected;
+
+  for (size_t i : { 0, 1, 15, 16, 31, 32, 33, 64, 150, 199 })
+  {
+    text[i] = '\n';
+    expected.push_back(i);
+  }
+
+  std::vector<size_t> positions;
+  cpptok::scan::findAll(text.data(), text.data() + text.size(), '\n', positions);
+  REQUIRE(positions == expected);
+
+  cpptok::LineIndex lines{ text };
+  REQUIRE(lines.lineCount() == expected.size() + 1);
+  REQUIRE(lines.lineOf(0) == 0);
+  REQUIRE(lines.lineOf(1) == 1);
+  REQUIRE(lines.lineOf(2) == 2);
+  REQUIRE(lines.lineOf(100) == 8);
+}
+
+TEST_CASE("Source file", "[cpptok]")
+{
+  const std::string path = "cpptok_test_sourcefile.cpp";
+  const std::string content = "#include <vector>\n/* multi\n line */ int main()\n{\n  return 0;\n}\n";
+
+  {
+    std::ofstream stream{ path, std::ios::binary };
+    stream << content;
+  }
+
+  cpptok::TokenizedFile tokenized;
+
+  {
+    cpptok::SourceFile file{ path };
+    REQUIRE(!file.isNull());
+    REQUIRE(file.path() == path);
+    REQUIRE(file.text() == content);
+
+    tokenized = file.tokenize();
+  }
+
+  cpptok::Tokenizer lexer;
+  lexer.tokenizeBuffer(content);
+
+  const cpptok::TokenBuffer& tokens = tokenized.tokens();
+  REQUIRE(tokens.size() == lexer.output.size());
+
+  for (size_t i(0); i < tokens.size(); ++i)
+  {
+    REQUIRE(tokens.type(i) == lexer.output[i].type());
+    REQUIRE(tokens.text(i) == lexer.output[i].text());
+  }
+
+  REQUIRE(tokens.text(3) == "int");
+  REQUIRE(tokenized.lineOf(3) == 2);
+  REQUIRE(tokenized.lines().lineCount() == 7);
+
+  tokenized = cpptok::TokenizedFile();
+  std::remove(path.c_str());
+
+  REQUIRE_THROWS_AS(cpptok::SourceFile("cpptok_test_does_not_exist.cpp"), std::runtime_error);
+}
+
+TEST_CASE("Empty source file", "[cpptok]")
+{
+  const std::string path = "cpptok_test_empty.cpp";
+  std::ofstream{ path, std::ios::binary };
+
+  cpptok::SourceFile file{ path };
+  REQUIRE(file.size() == 0);
+  REQUIRE(file.text().empty());
+  REQUIRE(file.tokenize().tokens().empty());
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Batch tokenizer", "[cpptok]")
+{
+  std::vector<std::string> sources;
+
+  for (size_t i(0); i < 50; ++i)
+  {
+    std::string src;
+
+    for (size_t j(0); j < (i * 37) % 200; ++j)
+      src += "int f" + std::to_string(j) + "() { /* body\n */ return " + std::to_string(i) + "; }\n";
+
+    sources.push_back(src);
+  }
+
+  std::vector<cpptok::string_view> buffers{ sources.begin(), sources.end() };
+
+  for (size_t threads : { 1, 4 })
+  {
+    cpptok::BatchTokenizer batch{ threads };
+    REQUIRE(batch.threadCount() == threads);
+
+    for (int pass(0); pass < 2; ++pass)
+    {
+      std::vector<cpptok::TokenBuffer> result = batch.tokenizeBuffers(buffers);
+      REQUIRE(result.size() == sources.size());
+
+      for (size_t i(0); i < sources.size(); ++i)
+      {
+        cpptok::Tokenizer lexer;
+        lexer.tokenizeBuffer(sources[i]);
+
+        REQUIRE(result[i].source().data() == sources[i].data());
+        REQUIRE(std::vector<cpptok::Token>(result[i].begin(), result[i].end()) == lexer.output);
+      }
+    }
+  }
+
+  cpptok::BatchTokenizer batch{ 3 };
+  REQUIRE_THROWS_AS(batch.tokenizeFiles({ "cpptok_test_does_not_exist.cpp" }), std::runtime_error);
+  REQUIRE(batch.tokenizeFiles({}).empty());
+}
+
+TEST_CASE("Chunked tokenization", "[cpptok]")
+{
+  std::string source;
+
+  for (size_t i(0); i < 300; ++i)
+  {
+    switch (i % 7)
+    {
+    case 0: source += "int x" + std::to_string(i) + " = " + std::to_string(i) + ";\n"; break;
+    case 1: source += "/* comment\n spanning */ auto s = \"str\"; /* again\n"; break;
+    case 2: source += "  still in the comment */ return 'c';\n"; break;
+    case 3: source += "#include <vector>\n"; break;
+    case 4: source += "/*\n\n*/ /* /* */ a /* x */ b /*\n"; break;
+    case 5: source += "\n code inside? */ x /* y */\n"; break;
+    default: source += "// single line comment\n"; break;
+    }
+  }
+
+  source += "char c = '\n';\n";
+  // strings continued on the next line by a backslash
+  source += "auto s = \"continued \\\n string /* \"; int y;\n";
+  source += "auto t = \"continued \\\r\n string */ \\\n again\"; int z;\n";
+  source += "/* unterminated\n comment";
+
+  cpptok::Tokenizer lexer;
+  lexer.tokenizeBuffer(source);
+
+  cpptok::BatchTokenizer batch{ 3 };
+
+  for (size_t chunk_size : { 1, 7, 20, 64, 100, 1000, 100000 })
+  {
+    cpptok::TokenBuffer tokens = batch.tokenizeChunked(source, chunk_size);
+    REQUIRE(std::vector<cpptok::Token>(tokens.begin(), tokens.end()) == lexer.output);
+
+    for (size_t i(0); i < tokens.size(); ++i)
+      REQUIRE(tokens.offset(i) == size_t(lexer.output[i].text().data() - source.data()));
+  }
+
+  REQUIRE(batch.tokenizeChunked(cpptok::string_view()).empty());
+}
+
+static bool same_tokens(const cpptok::DocumentTokenizer& a, const cpptok::DocumentTokenizer& b)
+{
+  if (a.lineCount() != b.lineCount())
+    return false;
+
+  for (size_t i(0); i < a.lineCount(); ++i)
+  {
+    if (a.tokens(i) != b.tokens(i) || a.stateAt(i) != b.stateAt(i))
+      return false;
+  }
+
+  return true;
+}
+
+TEST_CASE("Document tokenizer", "[cpptok]")
+{
+  std::string source;
+
+  for (size_t i(0); i < 100; ++i)
+    source += "int f" + std::to_string(i) + "() { return " + std::to_string(i) + "; }\n";
+
+  cpptok::DocumentTokenizer doc{ source };
+  REQUIRE(doc.lineCount() == 101);
+  REQUIRE(doc.text() == source);
+  REQUIRE(doc.tokens(3).size() == 9);
+
+  // editing a line only relexes that line
+  REQUIRE(doc.replace(10, 4, 10, 7, "g") == 1);
+  REQUIRE(doc.line(10) == "int g() { return 10; }");
+  REQUIRE(doc.tokens(10).at(1).text() == "g");
+
+  // opening a comment relexes everything after it
+  REQUIRE(doc.insert(20, 0, "/* ") == 81);
+  REQUIRE(doc.stateAt(50) == cpptok::Tokenizer::LongComment);
+
+  // closing it changes the state of all the following lines
+  REQUIRE(doc.insert(30, 0, " */") == 71);
+  REQUIRE(doc.stateAt(31) == cpptok::Tokenizer::Default);
+
+  // edits inside the comment do not propagate
+  REQUIRE(doc.insert(25, 0, "int") == 1);
+  REQUIRE(same_tokens(doc, cpptok::DocumentTokenizer(doc.text())));
+
+  // multi-line insertion and removal
+  REQUIRE(doc.insert(40, 5, "x;\n/* a\nb */ int y") == 3);
+  REQUIRE(doc.lineCount() == 103);
+  REQUIRE(doc.line(41) == "/* a");
+  REQUIRE(same_tokens(doc, cpptok::DocumentTokenizer(doc.text())));
+
+  REQUIRE(doc.replace(40, 0, 45, 3, "") == 1);
+  REQUIRE(doc.lineCount() == 98);
+  REQUIRE(same_tokens(doc, cpptok::DocumentTokenizer(doc.text())));
+
+  REQUIRE_THROWS_AS(doc.replace(1, 0, 0, 0, ""), std::out_of_range);
+  REQUIRE_THROWS_AS(doc.insert(0, 1000, "x"), std::out_of_range);
+
+  cpptok::DocumentTokenizer empty;
+  REQUIRE(empty.lineCount() == 1);
+  REQUIRE(empty.tokens(0).empty());
+}
+
+TEST_CASE("Pull tokens", "[cpptok]")
+{
+  const std::vector<std::string> lines = {
+    "#include <vector>",
+    "#include",
+    "  #  include \"foo.h\" // comment",
+    "int a = 0; /* start",
+    "",
+    " still a comment",
+    " end */ return a;",
+    "#include <unterminated",
+    "/* single */ x",
+  };
+
+  cpptok::Tokenizer eager;
+  cpptok::Tokenizer lazy;
+  std::vector<cpptok::Token> pulled;
+
+  for (const std::string& line : lines)
+  {
+    eager.tokenize(line);
+
+    lazy.setInput(line);
+
+    for (const cpptok::Token& tok : lazy.tokens())
+      pulled.push_back(tok);
+
+    REQUIRE(lazy.state == eager.state);
+  }
+
+  REQUIRE(pulled == eager.output);
+  REQUIRE(lazy.output.empty());
+
+  // the empty line inside the comment produces an empty comment token
+  REQUIRE(std::count(pulled.begin(), pulled.end(), cpptok::Token(cpptok::TokenType::MultiLineComment, "")) == 1);
+
+  // early exit
+  cpptok::Tokenizer lexer;
+  lexer.setInput("#include <map> int x = 0;");
+
+  cpptok::Token tok;
+  REQUIRE(lexer.next(tok));
+  REQUIRE(tok == cpptok::Token(cpptok::TokenType::Preproc, "#include"));
+  REQUIRE(lexer.next(tok));
+  REQUIRE(tok == cpptok::Token(cpptok::TokenType::Include, "<map>"));
+  REQUIRE(lexer.output.empty());
+
+  lexer.setInput("");
+  REQUIRE(!lexer.next(tok));
+}
+
+TEST_CASE("Token sinks", "[cpptok]")
+{
+  const std::vector<std::string> lines = {
+    "#include <vector> // std::vector",
+    "int main() { /* comment",
+    " still a comment */ return 0; }",
+  };
+
+  cpptok::Tokenizer lexer;
+
+  for (const std::string& line : lines)
+    lexer.tokenize(line);
+
+  cpptok::BasicTokenizer<cpptok::CountingSink> counter;
+  std::vector<cpptok::Token> filtered;
+  cpptok::BasicTokenizer<cpptok::SkipCommentsSink<cpptok::TokenVectorSink>> filter{ { {}, cpptok::TokenVectorSink(filtered) } };
+  std::vector<cpptok::Token> called;
+  cpptok::BasicTokenizer callback{ [&called](const cpptok::Token& tok) { called.push_back(tok); } };
+
+  for (const std::string& line : lines)
+  {
+    counter.tokenize(line);
+    filter.tokenize(line);
+    callback.tokenize(line);
+  }
+
+  REQUIRE(called == lexer.output);
+  REQUIRE(counter.state == lexer.state);
+  REQUIRE(filter.state == lexer.state);
+
+  const cpptok::CountingSink& counts = counter.sink();
+  REQUIRE(counts.count() == lexer.output.size());
+  REQUIRE(counts.count(cpptok::TokenType::MultiLineComment) == 2);
+  REQUIRE(counts.count(cpptok::TokenType::Include) == 1);
+  REQUIRE(counts.count(cpptok::TokenCategory::Keyword) == 2);
+  REQUIRE(counts.count(cpptok::TokenCategory::Identifier) == 3);
+
+  std::vector<cpptok::Token> expected;
+  std::copy_if(lexer.output.begin(), lexer.output.end(), std::back_inserter(expected), [](const cpptok::Token& tok) {
+    return !tok.isComment();
+    });
+  REQUIRE(filtered == expected);
+
+  const std::string source = "int a = 0; /* c */ return a;";
+  cpptok::TokenBuffer buffer{ source };
+  cpptok::BasicTokenizer<cpptok::TokenBufferSink> compact{ cpptok::TokenBufferSink(buffer) };
+  compact.tokenize(source);
+  REQUIRE(buffer.size() == 9);
+  REQUIRE(buffer.text(5) == "/* c */");
+}
+
+TEST_CASE("Fill caller-provided arrays", "[cpptok]")
+{
+  const std::vector<std::string> lines = {
+    "#include <vector>",
+    "int main() { /* comment",
+    "",
+    " still a comment */ return 0; }",
+    "#include \"foo.h\" // trailing",
+  };
+
+  cpptok::Tokenizer eager;
+
+  for (const std::string& line : lines)
+    eager.tokenize(line);
+
+  for (size_t capacity : { 1, 2, 3, 5, 64 })
+  {
+    cpptok::Tokenizer lexer;
+    std::vector<cpptok::Token> tokens;
+    cpptok::Token span[64];
+
+    for (const std::string& line : lines)
+    {
+      lexer.setInput(line);
+
+      size_t n;
+
+      do
+      {
+        n = lexer.fill(span, capacity);
+        tokens.insert(tokens.end(), span, span + n);
+      } while (n == capacity);
+    }
+
+    REQUIRE(tokens == eager.output);
+    REQUIRE(lexer.state == eager.state);
+    REQUIRE(lexer.output.empty());
+  }
+
+  cpptok::Tokenizer lexer;
+  lexer.setInput("a b");
+  cpptok::Token span[2];
+  REQUIRE(lexer.fill(span, 0) == 0);
+  REQUIRE(lexer.fill(span, 2) == 2);
+  REQUIRE(lexer.fill(span, 2) == 0);
+}
+
+TEST_CASE("Tokenize lines", "[cpptok]")
+{
+  const std::vector<std::string> lines = {
+    "#include <vector>",
+    "",
+    "int main() { /* comment",
+    " still a comment */ return 0; }",
+  };
+
+  cpptok::Tokenizer eager;
+  std::vector<size_t> sizes;
+
+  for (const std::string& line : lines)
+  {
+    eager.tokenize(line);
+    sizes.push_back(eager.output.size());
+  }
+
+  cpptok::Tokenizer lexer;
+  lexer.tokenize("x");
+
+  std::vector<size_t> offsets;
+  lexer.tokenizeLines(std::vector<cpptok::string_view>(lines.begin(), lines.end()), offsets);
+
+  REQUIRE(std::vector<cpptok::Token>(lexer.output.begin() + 1, lexer.output.end()) == eager.output);
+  REQUIRE(offsets == std::vector<size_t>{ 1, 1 + sizes[0], 1 + sizes[1], 1 + sizes[2], 1 + sizes[3] });
+  REQUIRE(lexer.state == eager.state);
+
+  lexer.tokenizeLines(nullptr, 0, offsets);
+  REQUIRE(offsets == std::vector<size_t>{ lexer.output.size() });
+
+  // a caller that reserved for the total size gets a single allocation
+  const std::string dense = "a+b-c*d/e;f<g>h";
+  cpptok::Tokenizer single;
+  single.output.reserve(dense.size());
+  const cpptok::Token* data = single.output.data();
+  const cpptok::string_view dense_line{ dense };
+  single.tokenizeLines(&dense_line, 1, offsets);
+  REQUIRE(single.output.size() == dense.size());
+  REQUIRE(single.output.data() == data);
+}
+
+TEST_CASE("Bracket index", "[cpptok]")
+{
+  cpptok::Tokenizer lexer;
+  cpptok::BracketIndex brackets;
+  lexer.brackets = &brackets;
+
+  lexer.tokenize("int f(int a[2]) {");
+  lexer.tokenize("  return g((a[0]), a[1]);");
+  REQUIRE(brackets.depth() == 1);
+  lexer.tokenize("}");
+
+  REQUIRE(brackets.size() == lexer.output.size());
+  REQUIRE(brackets.isBalanced());
+
+  for (size_t i(0); i < lexer.output.size(); ++i)
+  {
+    const cpptok::Token& tok = lexer.output[i];
+
+    if (tok == cpptok::TokenType::LeftPar || tok == cpptok::TokenType::LeftBracket || tok == cpptok::TokenType::LeftBrace)
+    {
+      REQUIRE(brackets.partner(i) > i);
+      REQUIRE(brackets.partner(brackets.partner(i)) == i);
+    }
+    else if (tok != cpptok::TokenType::RightPar && tok != cpptok::TokenType::RightBracket && tok != cpptok::TokenType::RightBrace)
+    {
+      REQUIRE(brackets.partner(i) == cpptok::BracketIndex::NotABracket);
+    }
+  }
+
+  REQUIRE(brackets.partner(2) == 8);
+  REQUIRE(brackets.partner(5) == 7);
+  REQUIRE(brackets.partner(9) == lexer.output.size() - 1);
+
+  lexer.reset();
+  REQUIRE(brackets.size() == 0);
+
+  // unbalanced brackets, through a sink
+  cpptok::BasicTokenizer<cpptok::BracketIndex> matcher;
+  matcher.tokenize("( ] { ) }");
+
+  const cpptok::BracketIndex& index = matcher.sink();
+  REQUIRE(!index.isBalanced());
+  REQUIRE(index.isUnbalanced(0));
+  REQUIRE(index.isUnbalanced(1));
+  REQUIRE(index.partner(2) == 4);
+  REQUIRE(index.isUnbalanced(3));
+}
+
+TEST_CASE("Scan includes", "[cpptok]")
+{
+  const std::string source =
+    "// #include \"commented.h\"\n"
+    "#include <vector>\n"
+    "  #  include \"a/b.h\" // trailing comment\n"
+    "/* a comment\n"
+    "#include <in_comment>\n"
+    "*/ #define S \"#include <in_string>\"\n"
+    "const char* s = \"\\\"\\\n"
+    "#include <continued_string>\";\n"
+    "char c = '\"'; int n = 1'000'000; /* x\n"
+    "#include <in_comment_after_separator>\n"
+    "*/\n"
+    "#define M(x) \\\n"
+    "#include <continued_line>\n"
+    "/**/#include <after_comment>\n"
+    "#include_next <not_include>\n"
+    "#include \"unterminated\n"
+    "#include <last>";
+
+  const std::vector<cpptok::IncludeDirective> includes = cpptok::scanIncludes(source);
+
+  std::vector<std::string> paths;
+  for (const cpptok::IncludeDirective& inc : includes)
+    paths.push_back(std::string(inc.path));
+
+  REQUIRE(paths == std::vector<std::string>{ "vector", "a/b.h", "after_comment", "last" });
+  REQUIRE(includes[0].angled);
+  REQUIRE(!includes[1].angled);
+  REQUIRE(includes[0].offset == source.find("#include <vector>"));
+  REQUIRE(includes[1].offset == source.find("#  include"));
+  REQUIRE(includes[3].offset == source.size() - std::strlen("#include <last>"));
+
+  // raw strings may contain newlines and quotes
+  const std::string raw =
+    "auto s = R\"x(\n"
+    "#include <in_raw_string> )\"\n"
+    ")x\";\n"
+    "auto t = u8R\"(\")\";\n"
+    "#include <after_raw_string>\n";
+
+  REQUIRE(cpptok::scanIncludes(raw).size() == 1);
+  REQUIRE(cpptok::scanIncludes(raw).front().path == "after_raw_string");
+
+  // byte order mark
+  const std::string bom = "\xEF\xBB\xBF#include <first>\n#include <second>\n";
+  REQUIRE(cpptok::scanIncludes(bom).size() == 2);
+  REQUIRE(cpptok::scanIncludes(bom).front().path == "first");
+  REQUIRE(cpptok::scanIncludes(bom).front().offset == 3);
+
+  // same result as a full tokenization on regular code
+  const std::string code =
+    "#include <map>\n"
+    "#include \"x.h\"\n"
+    "int f() { return '#'; } /* #include <y>\n"
+    "#include <z> */\n"
+    "#include <w>\n";
+
+  cpptok::Tokenizer lexer;
+  lexer.tokenizeBuffer(code);
+
+  std::vector<std::string_view> expected;
+  for (const cpptok::Token& tok : lexer.output)
+  {
+    if (tok == cpptok::TokenType::Include)
+      expected.push_back(tok.text().substr(1, tok.text().size() - 2));
+  }
+
+  std::vector<std::string_view> scanned;
+  for (const cpptok::IncludeDirective& inc : cpptok::scanIncludes(code))
+    scanned.push_back(inc.path);
+
+  REQUIRE(scanned == expected);
+  REQUIRE(scanned.size() == 3);
+}
+
+TEST_CASE("Symbol table", "[cpptok]")
+{
+  cpptok::SymbolTable table;
+
+  const uint32_t foo = table.intern("foo");
+  const uint32_t bar = table.intern("bar");
+  REQUIRE(foo == 0);
+  REQUIRE(bar == 1);
+  REQUIRE(table.intern(std::string("foo")) == foo);
+  REQUIRE(table.find("bar") == bar);
+  REQUIRE(table.find("baz") == cpptok::SymbolTable::NoSymbol);
+  REQUIRE(table.name(bar) == "bar");
+  REQUIRE_THROWS_AS(table.name(2), std::out_of_range);
+
+  // growing the table keeps the ids
+  std::vector<std::string> names;
+  for (int i(0); i < 10000; ++i)
+    names.push_back("name_" + std::to_string(i) + std::string(i % 100, 'x'));
+
+  for (const std::string& n : names)
+    table.intern(n);
+
+  REQUIRE(table.size() == names.size() + 2);
+  REQUIRE(table.find("foo") == foo);
+
+  for (size_t i(0); i < names.size(); ++i)
+  {
+    REQUIRE(table.find(names[i]) == i + 2);
+    REQUIRE(table.name(uint32_t(i + 2)) == names[i]);
+  }
+
+  // identifiers of the tokenizer output
+  cpptok::SymbolTable symbols;
+  cpptok::SymbolIndex index{ symbols };
+  cpptok::Tokenizer lexer;
+  lexer.symbols = &index;
+  lexer.tokenize("int foo(int bar) {");
+  lexer.tokenize("  return bar + foo(bar - 1);");
+
+  REQUIRE(index.size() == lexer.output.size());
+
+  for (size_t i(0); i < lexer.output.size(); ++i)
+  {
+    if (lexer.output[i] == cpptok::TokenType::UserDefinedName)
+      REQUIRE(symbols.name(index.id(i)) == lexer.output[i].text());
+    else
+      REQUIRE(index.id(i) == cpptok::SymbolTable::NoSymbol);
+  }
+
+  REQUIRE(symbols.size() == 2);
+  REQUIRE(index.id(1) == index.id(10));
+  REQUIRE(index.id(4) == index.id(8));
+
+  lexer.reset();
+  REQUIRE(index.size() == 0);
+  REQUIRE(symbols.size() == 2);
+}
+
+TEST_CASE("Concurrent symbol table", "[cpptok]")
+{
+  cpptok::SymbolTable table{ true };
+  REQUIRE(table.isConcurrent());
+
+  std::vector<std::string> sources;
+  for (int i(0); i < 16; ++i)
+  {
+    std::string src;
+    for (int j(0); j < 500; ++j)
+      src += "int f" + std::to_string((i * 7 + j) % 1000) + " = g" + std::to_string(j) + ";\n";
+    sources.push_back(src);
+  }
+
+  std::vector<std::vector<cpptok::Token>> tokens(sources.size());
+  std::vector<std::vector<uint32_t>> ids(sources.size());
+
+  cpptok::BatchTokenizer batch{ 4 };
+  batch.run(std::vector<size_t>(sources.size(), 1), [&](cpptok::Tokenizer& lexer, size_t i) {
+    cpptok::SymbolIndex index{ table };
+    lexer.reset();
+    lexer.symbols = &index;
+    lexer.tokenizeBuffer(sources[i]);
+    lexer.symbols = nullptr;
+    tokens[i] = lexer.output;
+    ids[i] = index.ids();
+    });
+
+  for (size_t i(0); i < sources.size(); ++i)
+  {
+    REQUIRE(ids[i].size() == tokens[i].size());
+
+    for (size_t j(0); j < tokens[i].size(); ++j)
+    {
+      if (tokens[i][j] == cpptok::TokenType::UserDefinedName)
+        REQUIRE(table.name(ids[i][j]) == tokens[i][j].text());
+    }
+  }
+
+  // f0 to f604, and g0 to g499
+  REQUIRE(table.size() == 605 + 500);
+  REQUIRE(table.intern("f42") == table.find("f42"));
+}
+
+TEST_CASE("Identifier table", "[cpptok]")
+{
+  cpptok::IdentifierTable table;
+  REQUIRE(table.lookup("while") == cpptok::TokenType::While);
+  REQUIRE(table.lookup("reinterpret_cast") == cpptok::TokenType::ReinterpretCast);
+  REQUIRE(table.lookup("whilst") == cpptok::TokenType::UserDefinedName);
+
+  table.add("Q_OBJECT", cpptok::TokenType::UserKind0);
+  table.add("signals", cpptok::TokenType::UserKind1);
+  table.add("slots", cpptok::TokenType::UserKind1);
+  table.add("concept", cpptok::TokenType::UserKind2);
+  table.add("import", cpptok::TokenType::UserDefinedName);
+  table.remove("export");
+
+  cpptok::Tokenizer lexer;
+  lexer.identifiers = &table;
+  lexer.tokenize("class A { Q_OBJECT signals: void f() override; import export concept x; };");
+
+  std::vector<cpptok::TokenType> types;
+  for (const cpptok::Token& tok : lexer.output)
+    types.push_back(tok.type());
+
+  REQUIRE(types == std::vector<cpptok::TokenType>{
+    cpptok::TokenType::Class, cpptok::TokenType::UserDefinedName, cpptok::TokenType::LeftBrace,
+    cpptok::TokenType::UserKind0, cpptok::TokenType::UserKind1, cpptok::TokenType::Colon,
+    cpptok::TokenType::Void, cpptok::TokenType::UserDefinedName, cpptok::TokenType::LeftPar, cpptok::TokenType::RightPar,
+    cpptok::TokenType::Override, cpptok::TokenType::Semicolon,
+    cpptok::TokenType::UserDefinedName, cpptok::TokenType::UserDefinedName,
+    cpptok::TokenType::UserKind2, cpptok::TokenType::UserDefinedName, cpptok::TokenType::Semicolon,
+    cpptok::TokenType::RightBrace, cpptok::TokenType::Semicolon,
+  });
+
+  REQUIRE(lexer.output[3].isIdentifier());
+  REQUIRE(!lexer.output[3].isKeyword());
+
+  // same classification as the built-in keyword table
+  const std::string source = " auto bool break case catch char class const const_cast constexpr continue decltype "
+    "default delete do double dynamic_cast else enum explicit export extern false final float for friend goto "
+    "if import inline int long mutable namespace noexcept nullptr operator override private protected public "
+    "reinterpret_cast return sizeof static static_assert static_cast struct switch template this throw true try "
+    "typedef typeid typename unsigned using virtual void while a ab abc x_ _x __ autos Bool ";
+
+  cpptok::Tokenizer builtin;
+  builtin.tokenize(source);
+
+  cpptok::IdentifierTable keywords;
+  cpptok::Tokenizer custom;
+  custom.identifiers = &keywords;
+  custom.tokenize(source);
+
+  REQUIRE(custom.output == builtin.output);
+
+  // many names
+  const size_t keyword_count = keywords.size();
+
+  for (int i(0); i < 5000; ++i)
+    keywords.add("macro_" + std::to_string(i), cpptok::TokenType::UserKind7);
+
+  REQUIRE(keywords.size() == keyword_count + 5000);
+
+  for (int i(0); i < 5000; ++i)
+    REQUIRE(keywords.lookup("macro_" + std::to_string(i)) == cpptok::TokenType::UserKind7);
+
+  REQUIRE(keywords.lookup("macro_5000") == cpptok::TokenType::UserDefinedName);
+
+  // names that only differ in their middle characters
+  for (int i(0); i < 20000; ++i)
+  {
+    char name[32];
+    std::snprintf(name, sizeof(name), "PROJ_%05d_MACRO", i);
+    keywords.add(name, cpptok::TokenType::UserKind6);
+  }
+
+  for (int i(0); i < 20000; ++i)
+  {
+    char name[32];
+    std::snprintf(name, sizeof(name), "PROJ_%05d_MACRO", i);
+    REQUIRE(keywords.lookup(name) == cpptok::TokenType::UserKind6);
+  }
+
+  REQUIRE(keywords.lookup("PROJ_20000_MACRO") == cpptok::TokenType::UserDefinedName);
+  REQUIRE(keywords.lookup("static_assert") == cpptok::TokenType::StaticAssert);
+
+  keywords.clear();
+  REQUIRE(keywords.lookup("int") == cpptok::TokenType::UserDefinedName);
+  REQUIRE_THROWS_AS(keywords.add("", cpptok::TokenType::UserKind0), std::invalid_argument);
+}
+
+TEST_CASE("Token stream", "[cpptok]")
+{
+  const std::string source =
+    "#include <vector>\n"
+    "int main() {\n"
+    "  /*" + std::string(70000, '*') + "*/\n"
+    "  return 0;\n"
+    "}\n";
+
+  cpptok::Tokenizer lexer;
+  cpptok::LineIndex lines;
+  lexer.tokenizeBuffer(source, &lines);
+
+  cpptok::TokenBuffer tokens{ source };
+  tokens.append(lexer.output);
+
+  const std::string path = "cpptok_test_tokenstream.bin";
+  cpptok::TokenStream::write(path, source, tokens, &lines);
+
+  {
+    cpptok::TokenStream stream{ path };
+
+    REQUIRE(!stream.isNull());
+    REQUIRE(stream.matches(source));
+    REQUIRE(!stream.matches(source.substr(1)));
+    REQUIRE(stream.sourceSize() == source.size());
+    REQUIRE(stream.sourceHash() == cpptok::TokenStream::hash(source));
+    REQUIRE(stream.size() == tokens.size());
+
+    for (size_t i(0); i < tokens.size(); ++i)
+    {
+      REQUIRE(stream.token(i, source) == tokens[i]);
+      REQUIRE(stream.lineOf(stream.offset(i)) == lines.lineOf(tokens.offset(i)));
+    }
+
+    REQUIRE(stream.length(7) == 70004);
+    REQUIRE(stream.lineCount() == lines.lineCount());
+    REQUIRE(stream.lineStart(3) == lines.lineStart(3));
+
+    const cpptok::TokenBuffer copy = stream.toTokenBuffer(source);
+    REQUIRE(std::equal(copy.begin(), copy.end(), tokens.begin(), tokens.end()));
+  }
+
+  // the line index is computed if it is not given
+  cpptok::TokenStream::write(path, source, tokens);
+  REQUIRE(cpptok::TokenStream(path).lineCount() == lines.lineCount());
+
+  // invalid files
+  {
+    std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+    file << "not a token stream, but long enough to hold a header..............................................";
+  }
+
+  REQUIRE_THROWS_AS(cpptok::TokenStream(path), std::runtime_error);
+
+  {
+    std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+    cpptok::TokenStream::write(file, source, tokens, &lines);
+  }
+
+  std::filesystem::resize_file(path, 200);
+  REQUIRE_THROWS_AS(cpptok::TokenStream(path), std::runtime_error);
+
+  // corrupted columns
+  std::ostringstream out;
+  cpptok::TokenStream::write(out, source, tokens, &lines);
+  const std::string valid = out.str();
+
+  auto header_field = [&valid](size_t offset) {
+    uint64_t value;
+    std::memcpy(&value, valid.data() + offset, sizeof(value));
+    return static_cast<size_t>(value);
+  };
+
+  const size_t offsets_column = header_field(64);
+  const size_t lengths_column = header_field(72);
+  const size_t long_tokens_column = header_field(80);
+  const size_t line_starts_column = header_field(88);
+
+  auto write_corrupted = [&](size_t offset, const void* data, size_t size) {
+    std::string content = valid;
+    std::memcpy(&content[offset], data, size);
+    std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+    file << content;
+  };
+
+  // a LongToken length without an entry in the long tokens table
+  const uint16_t long_length = cpptok::TokenBuffer::LongToken;
+  write_corrupted(lengths_column, &long_length, sizeof(long_length));
+  REQUIRE_THROWS_AS(cpptok::TokenStream(path), std::runtime_error);
+
+  // a token past the end of the source
+  const uint32_t bad_offset = static_cast<uint32_t>(source.size());
+  write_corrupted(offsets_column + (tokens.size() - 1) * sizeof(uint32_t), &bad_offset, sizeof(bad_offset));
+  REQUIRE_THROWS_AS(cpptok::TokenStream(path), std::runtime_error);
+
+  const uint16_t too_long = 0x7FFF;
+  write_corrupted(lengths_column + (tokens.size() - 1) * sizeof(uint16_t), &too_long, sizeof(too_long));
+  REQUIRE_THROWS_AS(cpptok::TokenStream(path), std::runtime_error);
+
+  // a long token that is not one
+  const uint64_t bad_index = 0;
+  write_corrupted(long_tokens_column, &bad_index, sizeof(bad_index));
+  REQUIRE_THROWS_AS(cpptok::TokenStream(path), std::runtime_error);
+
+  const uint64_t bad_line_start = source.size() + 1;
+  write_corrupted(line_starts_column + (lines.lineCount() - 1) * sizeof(uint64_t), &bad_line_start, sizeof(bad_line_start));
+  REQUIRE_THROWS_AS(cpptok::TokenStream(path), std::runtime_error);
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Token cache", "[cpptok]")
+{
+  const std::string dir = "cpptok_test_cache";
+  std::filesystem::remove_all(dir);
+
+  const std::string a = "int a = 0; // a\n";
+  const std::string b = "int b = 1; /* b */\n";
+  const std::string c = "int c = 2; /* " + std::string(100, 'c') + " */\n";
+
+  {
+    cpptok::TokenCache cache{ dir };
+
+    cpptok::TokenStream first = cache.tokenize(a);
+    REQUIRE(cache.misses() == 1);
+    REQUIRE(cache.hits() == 0);
+    REQUIRE(first.size() == 6);
+    REQUIRE(first.token(5, a).text() == "// a");
+
+    // same content, different string
+    const std::string copy = a;
+    cpptok::TokenStream second = cache.tokenize(copy);
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(second.file().path() == first.file().path());
+    REQUIRE(second.token(5, copy).text() == "// a");
+
+    REQUIRE(cache.find(b).isNull());
+    REQUIRE(cache.misses() == 2);
+    REQUIRE(cache.size() == first.file().size());
+  }
+
+  // entries persist
+  {
+    cpptok::TokenCache cache{ dir };
+    REQUIRE(cache.size() > 0);
+    REQUIRE(!cache.find(a).isNull());
+
+    // keeps room for two entries (and a half, as eviction goes down to 90%)
+    const uint64_t entry_size = cache.size();
+    cache.setMaxSize(5 * entry_size / 2);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    cache.tokenize(b);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(!cache.find(a).isNull()); // a is now more recent than b
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    cache.tokenize(c);
+
+    REQUIRE(cache.size() <= cache.maxSize());
+    REQUIRE(!cache.find(a).isNull());
+    REQUIRE(cache.find(b).isNull());
+    REQUIRE(!cache.find(c).isNull());
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.find(a).isNull());
+  }
+
+  // corrupted entries are misses
+  {
+    cpptok::TokenCache cache{ dir };
+    cache.tokenize(a);
+
+    {
+      std::ofstream file{ cache.entryPath(a), std::ios::binary | std::ios::trunc };
+      file << "garbage";
+    }
+
+    REQUIRE(cache.find(a).isNull());
+    REQUIRE(cache.tokenize(a).size() == 6);
+    REQUIRE(!cache.find(a).isNull());
+
+    // intact header, corrupted token columns
+    std::string content;
+
+    {
+      std::ifstream file{ cache.entryPath(a), std::ios::binary };
+      content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    uint64_t offsets_column;
+    std::memcpy(&offsets_column, content.data() + 64, sizeof(offsets_column));
+    const uint32_t bad_offset = 0x7FFFFFFF;
+    std::memcpy(&content[offsets_column + sizeof(uint32_t)], &bad_offset, sizeof(bad_offset));
+
+    {
+      std::ofstream file{ cache.entryPath(a), std::ios::binary | std::ios::trunc };
+      file << content;
+    }
+
+    const size_t misses = cache.misses();
+    REQUIRE(cache.find(a).isNull());
+    REQUIRE(cache.misses() == misses + 1);
+
+    cpptok::TokenStream replaced = cache.tokenize(a);
+    REQUIRE(replaced.token(1, a).text() == "a");
+    REQUIRE(!cache.find(a).isNull());
+  }
+
+  // many inserts in a full cache
+  {
+    cpptok::TokenCache cache{ dir };
+    cache.clear();
+
+    std::vector<std::string> sources;
+    for (int i(0); i < 300; ++i)
+      sources.push_back("int x" + std::to_string(i) + " = " + std::to_string(i) + ";\n");
+
+    cache.tokenize(sources[0]);
+    const uint64_t entry_size = cache.size();
+    cache.setMaxSize(50 * entry_size);
+
+    auto entry_count = [&dir]() {
+      size_t n = 0;
+      for (const std::filesystem::directory_entry& e : std::filesystem::directory_iterator(dir))
+        n += e.path().extension() == ".tokens";
+      return n;
+    };
+
+    size_t evictions = 0;
+    size_t previous = entry_count();
+
+    for (size_t i(1); i < sources.size(); ++i)
+    {
+      cache.tokenize(sources[i]);
+      REQUIRE(cache.size() <= cache.maxSize());
+
+      const size_t n = entry_count();
+
+      if (n < previous + 1)
+      {
+        // an eviction leaves room for several entries
+        ++evictions;
+        REQUIRE(cache.size() <= cache.maxSize() - cache.maxSize() / 10);
+      }
+
+      previous = n;
+    }
+
+    REQUIRE(evictions > 0);
+    REQUIRE(evictions <= sources.size() / 4);
+    REQUIRE(!cache.find(sources.back()).isNull());
+    cache.clear();
+  }
+
+  // concurrent inserts of the same source
+  {
+    cpptok::TokenCache cache{ dir };
+    cache.clear();
+
+    std::vector<std::thread> threads;
+
+    for (int i(0); i < 4; ++i)
+    {
+      threads.emplace_back([&cache, &a]() {
+        for (int j(0); j < 20; ++j)
+          cache.insert(a, cpptok::TokenBuffer{ a });
+        });
+    }
+
+    for (std::thread& t : threads)
+      t.join();
+
+    REQUIRE(cache.size() == std::filesystem::file_size(cache.entryPath(a)));
+
+    cache.evict();
+    REQUIRE(cache.size() == std::filesystem::file_size(cache.entryPath(a)));
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+  }
+
+  // temporary files left over by crashed writers
+  {
+    cpptok::TokenCache cache{ dir };
+    const std::string stale = cache.entryPath(a) + ".12345-1.tmp";
+    const std::string fresh = cache.entryPath(b) + ".12345-2.tmp";
+    std::ofstream{ stale } << "partial";
+    std::ofstream{ fresh } << "partial";
+    std::filesystem::last_write_time(stale, std::filesystem::file_time_type::clock::now() - std::chrono::hours(1));
+
+    cache.evict();
+    REQUIRE(!std::filesystem::exists(stale));
+    REQUIRE(std::filesystem::exists(fresh));
+
+    cache.clear();
+    REQUIRE(std::filesystem::exists(fresh));
+    std::filesystem::remove(fresh);
+
+    // successful writes leave no temporary file
+    cache.tokenize(a);
+    cache.insert(a, cpptok::TokenBuffer{ a });
+
+    for (const std::filesystem::directory_entry& e : std::filesystem::directory_iterator(dir))
+      REQUIRE(e.path().extension() != ".tmp");
+  }
+
+  std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Compressed token buffer", "[cpptok]")
+{
+  std::string source;
+
+  for (int i(0); i < 200; ++i)
+    source += "int a" + std::to_string(i) + " = f(\"x\", 'c') + 0x" + std::to_string(i) + "; // comment\n";
+
+  source += "/*" + std::string(100000, '*') + "*/ return a;\n";
+
+  cpptok::Tokenizer lexer;
+  lexer.tokenizeBuffer(source);
+
+  cpptok::CompressedTokenBuffer buffer{ source };
+  buffer.append(lexer.output);
+
+  REQUIRE(buffer.size() == lexer.output.size());
+  REQUIRE(buffer.size() > 2 * cpptok::CompressedTokenBuffer::BlockSize);
+
+  for (size_t i(0); i < buffer.size(); ++i)
+  {
+    REQUIRE(buffer[i] == lexer.output[i]);
+  }
+
+  const size_t comment = buffer.size() - 4;
+  REQUIRE(buffer.type(comment) == cpptok::TokenType::MultiLineComment);
+  REQUIRE(buffer.length(comment) == 100004);
+  REQUIRE(buffer.offset(comment + 1) == source.rfind("return"));
+  REQUIRE(buffer.text(comment + 1) == "return");
+
+  std::vector<cpptok::Token> tokens{ buffer.begin(), buffer.end() };
+  REQUIRE(tokens == lexer.output);
+
+  // iterators can start in the middle of a block
+  auto it = cpptok::CompressedTokenBuffer::const_iterator(&buffer, 100);
+  REQUIRE(*it == lexer.output[100]);
+  REQUIRE(*++it == lexer.output[101]);
+
+  REQUIRE(buffer.memoryUsage() * 4 < lexer.output.size() * sizeof(cpptok::Token));
+
+  cpptok::TokenBuffer compact{ source };
+  compact.append(lexer.output);
+  cpptok::CompressedTokenBuffer copy{ source };
+  copy.append(compact);
+  REQUIRE(std::equal(copy.begin(), copy.end(), buffer.begin()));
+
+  REQUIRE_THROWS_AS(buffer.at(buffer.size()), std::out_of_range);
+  REQUIRE_THROWS_AS(buffer.push_back(cpptok::TokenType::Semicolon, 0, 1), std::invalid_argument);
+
+  buffer.clear();
+  REQUIRE(buffer.empty());
+  REQUIRE(buffer.begin() == buffer.end());
+  buffer.push_back(lexer.output.front());
+  REQUIRE(buffer[0] == lexer.output.front());
+}
+
+TEST_CASE("Dependency graph", "[cpptok]")
+{
+  namespace fs = std::filesystem;
+
+  const fs::path dir = fs::temp_directory_path() / "cpptok_test_deps";
+  fs::remove_all(dir);
+
+  auto write = [&dir](const std::string& name, const std::string& content) {
+    fs::create_directories((dir / name).parent_path());
+    std::ofstream file{ dir / name, std::ios::binary };
+    file << content;
+  };
+
+  write("src/main.cpp",
+    "#include \"a.h\"\n"
+    "#include <a.h>\n"
+    "#include <lib/b.h>\n"
+    "#include \"lib/b2.h\"\n"
+    "#include <missing.h>\n"
+    "#include \"my header.h\"\n");
+  write("src/a.h", "#include \"sub/c.h\"\n");
+  write("src/sub/c.h", "#include \"../a.h\"\n");
+  write("src/my header.h", "");
+  write("src/tool.h", "#include \"a.h\"\n");
+  write("inc/a.h", "");
+  write("inc/lib/b.h", "#include \"b2.h\"\n");
+  write("inc/lib/b2.h", "");
+
+  const std::string src = (dir / "src").lexically_normal().generic_string() + "/";
+  const std::string inc = (dir / "inc").lexically_normal().generic_string() + "/";
+
+  cpptok::DependencyGraph graph;
+  graph.addSearchPath((dir / "inc").string());
+  graph.addRoot((dir / "src" / "main.cpp").string());
+  graph.addRoot((dir / "src" / "tool.h").string());
+
+  cpptok::BatchTokenizer batch{ 2 };
+  graph.scan(batch);
+
+  REQUIRE(graph.files().size() == 8);
+  REQUIRE(graph.statistics().includes == 10);
+  REQUIRE(graph.statistics().unresolved == 1);
+
+  const size_t main = graph.indexOf(src + "main.cpp");
+  REQUIRE(main == 0);
+  REQUIRE(graph.indexOf(src + "missing.h") == cpptok::DependencyGraph::NoFile);
+
+  // quoted includes are first searched next to the includer, angled ones only in the search paths
+  const std::vector<cpptok::DependencyGraph::Include>& includes = graph.files()[main].includes;
+  REQUIRE(includes.size() == 6);
+  REQUIRE(includes[0].file == graph.indexOf(src + "a.h"));
+  REQUIRE(includes[1].file == graph.indexOf(inc + "a.h"));
+  REQUIRE(includes[2].file == graph.indexOf(inc + "lib/b.h"));
+  REQUIRE(includes[3].file == graph.indexOf(inc + "lib/b2.h"));
+  REQUIRE(includes[4].file == cpptok::DependencyGraph::NoFile);
+  REQUIRE(includes[4].angled);
+  REQUIRE(!includes[5].angled);
+
+  REQUIRE(graph.files()[graph.indexOf(inc + "lib/b.h")].includes.front().file == graph.indexOf(inc + "lib/b2.h"));
+
+  // a.h and sub/c.h include each other
+  const size_t a = graph.indexOf(src + "a.h");
+  const size_t c = graph.indexOf(src + "sub/c.h");
+  REQUIRE(graph.dependencies(a) == std::vector<size_t>{ c });
+  REQUIRE(graph.dependencies(c) == std::vector<size_t>{ a });
+
+  std::vector<size_t> deps = graph.dependencies(main);
+  REQUIRE(deps.size() == 6);
+  REQUIRE(std::find(deps.begin(), deps.end(), main) == deps.end());
+
+  // one rule per root translation unit, headers are not targets
+  std::ostringstream make;
+  graph.writeMakefile(make);
+  REQUIRE(make.str() ==
+    src + "main.o: " + src + "main.cpp \\\n"
+    "  " + src + "a.h \\\n"
+    "  " + src + "sub/c.h \\\n"
+    "  " + inc + "a.h \\\n"
+    "  " + inc + "lib/b.h \\\n"
+    "  " + inc + "lib/b2.h \\\n"
+    "  " + src + "my\\ header.h\n");
+
+  std::ostringstream json;
+  graph.writeJson(json);
+  const std::string output = json.str();
+  REQUIRE(output.rfind("{\n  \"files\": [\n    { \"path\": \"" + src + "main.cpp\", \"root\": true, \"includes\": [", 0) == 0);
+  REQUIRE(output.find("{ \"name\": \"missing.h\", \"angled\": true, \"file\": null }") != std::string::npos);
+  REQUIRE(output.find("{ \"name\": \"a.h\", \"angled\": false, \"file\": " + std::to_string(a) + " }") != std::string::npos);
+  REQUIRE(output.find("\"path\": \"" + src + "tool.h\", \"root\": true") != std::string::npos);
+  REQUIRE(output.find("\"path\": \"" + inc + "lib/b.h\", \"root\": false") != std::string::npos);
+  REQUIRE(output.substr(output.size() - 7) == "\n  ]\n}\n");
+
+  // files that cannot be read do not prevent the others from being scanned
+  write("src/gone.cpp", "#include \"a.h\"\n");
+  write("src/other.cpp", "#include \"a.h\"\n");
+
+  cpptok::DependencyGraph partial;
+  partial.addRoot((dir / "src" / "gone.cpp").string());
+  partial.addRoot((dir / "src" / "other.cpp").string());
+  fs::remove(dir / "src" / "gone.cpp");
+  partial.scan(batch);
+
+  REQUIRE(partial.files().size() == 4);
+  REQUIRE(partial.statistics().failed == 1);
+  REQUIRE(partial.statistics().passes == 3);
+  REQUIRE(!partial.files()[0].error.empty());
+  REQUIRE(partial.files()[0].includes.empty());
+  REQUIRE(partial.files()[1].error.empty());
+  REQUIRE(partial.dependencies(1).size() == 2);
+
+  std::ostringstream partial_json;
+  partial.writeJson(partial_json);
+  REQUIRE(partial_json.str().find("\"error\": \"") != std::string::npos);
+
+  REQUIRE(cpptok::jsonEscape("a\"b\\c\nd\x01") == "a\\\"b\\\\c\\nd\\u0001");
+
+  fs::remove_all(dir);
+}